@@ -0,0 +1,410 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "engine.h"
+#include "metrics.h"
+#include "platform.h"
+#include "replay.h"
+#include "timing.h"
+
+// Files are handed out in batches so workers don't contend on the shared index for every small replay
+#define FILE_BATCH 64
+// Per-worker CSV rows are written out under the lock once this much has piled up
+#define CSV_BUFFER_SIZE (64 * 1024)
+
+// Every path in one buffer, millions of replays would otherwise be millions of small allocations
+typedef struct FileList {
+  char *names;
+  size_t names_size;
+  size_t names_capacity;
+  size_t *offsets;
+  size_t count;
+  size_t capacity;
+} FileList;
+
+static void addFile(FileList *list, const char *path) {
+  const size_t length = strlen(path) + 1;
+  if (list->names_size + length > list->names_capacity) {
+    list->names_capacity = (list->names_size + length) * 2;
+    list->names = realloc(list->names, list->names_capacity);
+  }
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 1024;
+    list->offsets = realloc(list->offsets, sizeof(size_t) * list->capacity);
+  }
+  memcpy(list->names + list->names_size, path, length);
+  list->offsets[list->count++] = list->names_size;
+  list->names_size += length;
+}
+
+static void visitFile(const char *path, void *user) {
+  const size_t length = strlen(path);
+  if (length > 4 && strcmp(path + length - 4, ".msr") == 0) {
+    addFile(user, path);
+  }
+}
+
+typedef enum Outcome { OUTCOME_WON, OUTCOME_LOST, OUTCOME_ABANDONED, OUTCOME_COUNT } Outcome;
+
+static const char *outcome_names[OUTCOME_COUNT] = {"won", "lost", "abandoned"};
+
+typedef struct GameStats {
+  Outcome outcome;
+  double seconds; // first click to the last move
+  int bbbv;
+  int clicks; // left, right and chord clicks, the first click included
+} GameStats;
+
+// Totals per board size and mine count. Time, speed and efficiency only count won games.
+typedef struct BoardGroup {
+  int width;
+  int height;
+  int mines;
+  uint64_t games[OUTCOME_COUNT];
+  uint64_t bbbv;
+  uint64_t clicks;
+  double seconds;
+  double bbbv_per_second;
+  double efficiency;
+  double best_seconds;
+  double best_bbbv_per_second;
+} BoardGroup;
+
+typedef struct Groups {
+  BoardGroup *groups;
+  int count;
+  int capacity;
+} Groups;
+
+static BoardGroup *findGroup(Groups *groups, int width, int height, int mines) {
+  for (int i = 0; i < groups->count; ++i) {
+    BoardGroup *group = &groups->groups[i];
+    if (group->width == width && group->height == height && group->mines == mines) {
+      return group;
+    }
+  }
+  if (groups->count == groups->capacity) {
+    groups->capacity = groups->capacity ? groups->capacity * 2 : 8;
+    groups->groups = realloc(groups->groups, sizeof(BoardGroup) * groups->capacity);
+  }
+  BoardGroup *group = &groups->groups[groups->count++];
+  *group = (BoardGroup){.width = width, .height = height, .mines = mines};
+  return group;
+}
+
+static void addGame(BoardGroup *group, const GameStats *stats) {
+  ++group->games[stats->outcome];
+  if (stats->outcome != OUTCOME_WON) {
+    return;
+  }
+  const double bbbv_per_second = stats->seconds > 0.0 ? stats->bbbv / stats->seconds : 0.0;
+  const bool first_win = group->games[OUTCOME_WON] == 1;
+  group->bbbv += stats->bbbv;
+  group->clicks += stats->clicks;
+  group->seconds += stats->seconds;
+  group->bbbv_per_second += bbbv_per_second;
+  group->efficiency += (double)stats->bbbv / stats->clicks;
+  if (first_win || stats->seconds < group->best_seconds) {
+    group->best_seconds = stats->seconds;
+  }
+  if (first_win || bbbv_per_second > group->best_bbbv_per_second) {
+    group->best_bbbv_per_second = bbbv_per_second;
+  }
+}
+
+static void mergeGroup(Groups *groups, const BoardGroup *from) {
+  BoardGroup *group = findGroup(groups, from->width, from->height, from->mines);
+  const bool had_wins = group->games[OUTCOME_WON] > 0;
+  for (int i = 0; i < OUTCOME_COUNT; ++i) {
+    group->games[i] += from->games[i];
+  }
+  if (from->games[OUTCOME_WON] == 0) {
+    return;
+  }
+  group->bbbv += from->bbbv;
+  group->clicks += from->clicks;
+  group->seconds += from->seconds;
+  group->bbbv_per_second += from->bbbv_per_second;
+  group->efficiency += from->efficiency;
+  if (!had_wins || from->best_seconds < group->best_seconds) {
+    group->best_seconds = from->best_seconds;
+  }
+  if (!had_wins || from->best_bbbv_per_second > group->best_bbbv_per_second) {
+    group->best_bbbv_per_second = from->best_bbbv_per_second;
+  }
+}
+
+typedef struct Shared {
+  const FileList *files;
+  atomic_size_t next;
+  FILE *csv;
+  mtx_t csv_lock;
+} Shared;
+
+typedef struct CsvRows {
+  char *data;
+  size_t size;
+  size_t capacity;
+} CsvRows;
+
+typedef struct AnalyseWorker {
+  Shared *shared;
+  // Results, merged after join
+  Groups groups;
+  uint64_t invalid;
+  uint64_t bytes;
+} AnalyseWorker;
+
+static void flushCsv(Shared *shared, CsvRows *rows) {
+  if (rows->size == 0) {
+    return;
+  }
+  mtx_lock(&shared->csv_lock);
+  fwrite(rows->data, 1, rows->size, shared->csv);
+  mtx_unlock(&shared->csv_lock);
+  rows->size = 0;
+}
+
+static void addCsvRow(Shared *shared, CsvRows *rows, const char *path, const Replay *replay, const GameStats *stats) {
+  const double bbbv_per_second = stats->seconds > 0.0 ? stats->bbbv / stats->seconds : 0.0;
+  // Flushes and retries when the row doesn't fit, growing the buffer only for a row longer than all of it
+  for (;;) {
+    const size_t room = rows->capacity - rows->size;
+    const int length = snprintf(rows->data + rows->size, room, "%s,%d,%d,%d,%s,%.3f,%d,%.4f,%d,%.4f\n", path, replay->width,
+                                replay->height, replay->mines, outcome_names[stats->outcome], stats->seconds, stats->bbbv,
+                                bbbv_per_second, stats->clicks, (double)stats->bbbv / stats->clicks);
+    if ((size_t)length < room) {
+      rows->size += length;
+      return;
+    }
+    flushCsv(shared, rows);
+    if ((size_t)length >= rows->capacity) {
+      rows->capacity = length + 1;
+      rows->data = realloc(rows->data, rows->capacity);
+    }
+  }
+}
+
+static void analyseGame(const Replay *replay, uint8_t *board, int32_t *scratch, GameStats *stats) {
+  replayPlay(replay, board);
+  stats->outcome = !game_over ? OUTCOME_ABANDONED : (game_won ? OUTCOME_WON : OUTCOME_LOST);
+  BoardMetrics metrics;
+  computeBoardMetrics(board, replay->width, replay->height, scratch, &metrics);
+  stats->bbbv = metrics.bbbv;
+  // The first click and the flags placed before it are in the header
+  stats->clicks = 1 + replay->num_flag_cells;
+  uint32_t last_move_ms = 0;
+  for (int i = 0; i < replay->num_events; ++i) {
+    if (replay->events[i].kind != REPLAY_PRESS) {
+      ++stats->clicks;
+      last_move_ms = replay->events[i].time_ms;
+    }
+  }
+  stats->seconds = last_move_ms / 1000.0;
+}
+
+static int analyseWorker(void *arg) {
+  AnalyseWorker *worker = arg;
+  Shared *shared = worker->shared;
+  const FileList *files = shared->files;
+  uint8_t *file_buffer = NULL;
+  size_t file_buffer_capacity = 0;
+  uint8_t *board = NULL;
+  int32_t *scratch = NULL;
+  int board_capacity = 0;
+  CsvRows rows = {0};
+  if (shared->csv) {
+    rows.capacity = CSV_BUFFER_SIZE;
+    rows.data = malloc(rows.capacity);
+  }
+
+  size_t first;
+  while ((first = atomic_fetch_add(&shared->next, FILE_BATCH)) < files->count) {
+    const size_t last = first + FILE_BATCH < files->count ? first + FILE_BATCH : files->count;
+    for (size_t i = first; i < last; ++i) {
+      const char *path = files->names + files->offsets[i];
+      FileView view;
+      Replay replay;
+      const bool opened = openFileView(path, &view, &file_buffer, &file_buffer_capacity);
+      const bool decoded = opened && replayDecode(view.data, view.size, &replay);
+      worker->bytes += view.size;
+      closeFileView(&view);
+      if (!decoded) {
+        ++worker->invalid;
+        continue;
+      }
+      const int cells = replay.width * replay.height;
+      if (cells > board_capacity) {
+        board_capacity = cells;
+        board = realloc(board, sizeof(uint8_t) * cells);
+        scratch = realloc(scratch, sizeof(int32_t) * cells);
+      }
+      GameStats stats;
+      analyseGame(&replay, board, scratch, &stats);
+      addGame(findGroup(&worker->groups, replay.width, replay.height, replay.mines), &stats);
+      if (rows.data) {
+        addCsvRow(shared, &rows, path, &replay, &stats);
+      }
+      replayFree(&replay);
+    }
+  }
+  if (rows.data) {
+    flushCsv(shared, &rows);
+  }
+  free(rows.data);
+  free(scratch);
+  free(board);
+  free(file_buffer);
+  freeEngineScratch();
+  return 0;
+}
+
+static int compareGroups(const void *a, const void *b) {
+  const BoardGroup *x = a;
+  const BoardGroup *y = b;
+  const int64_t cells = (int64_t)x->width * x->height - (int64_t)y->width * y->height;
+  if (cells != 0) {
+    return (cells > 0) - (cells < 0);
+  }
+  return x->width != y->width ? x->width - y->width : x->mines - y->mines;
+}
+
+static void writeJson(FILE *file, const Groups *groups, uint64_t invalid, uint64_t files, double seconds) {
+  fprintf(file, "{\n  \"files\": %llu,\n  \"invalid\": %llu,\n  \"seconds\": %.3f,\n  \"boards\": [", (unsigned long long)files,
+          (unsigned long long)invalid, seconds);
+  for (int i = 0; i < groups->count; ++i) {
+    const BoardGroup *group = &groups->groups[i];
+    const uint64_t won = group->games[OUTCOME_WON];
+    const uint64_t games = won + group->games[OUTCOME_LOST] + group->games[OUTCOME_ABANDONED];
+    fprintf(file,
+            "%s\n    {\"width\": %d, \"height\": %d, \"mines\": %d, \"games\": %llu, \"won\": %llu, \"lost\": %llu, \"abandoned\": %llu, "
+            "\"win_rate\": %.4f, \"mean_seconds\": %.3f, \"best_seconds\": %.3f, \"mean_3bv\": %.2f, \"mean_3bv_per_second\": %.4f, "
+            "\"best_3bv_per_second\": %.4f, \"mean_clicks\": %.2f, \"mean_efficiency\": %.4f}",
+            i ? "," : "", group->width, group->height, group->mines, (unsigned long long)games, (unsigned long long)won,
+            (unsigned long long)group->games[OUTCOME_LOST], (unsigned long long)group->games[OUTCOME_ABANDONED],
+            games ? (double)won / games : 0.0, won ? group->seconds / won : 0.0, group->best_seconds,
+            won ? (double)group->bbbv / won : 0.0, won ? group->bbbv_per_second / won : 0.0, group->best_bbbv_per_second,
+            won ? (double)group->clicks / won : 0.0, won ? group->efficiency / won : 0.0);
+  }
+  fprintf(file, "\n  ]\n}\n");
+}
+
+// minesweeper-analyse [--threads n] [--csv file] [--json file] path...
+// Reads every .msr replay under the given directories (or the given files) on a worker pool and reports, per board size,
+// the outcomes and for won games the time, 3BV, 3BV/s, clicks and efficiency (3BV per click). --csv writes one row per
+// game in no particular order, --json the totals.
+int main(int argc, char **argv) {
+  int threads = getCoreCount();
+  const char *csv_path = NULL;
+  const char *json_path = NULL;
+  FileList files = {0};
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) {
+      threads = atoi(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "--csv") == 0) {
+      csv_path = argv[++i];
+    } else if (i + 1 < argc && strcmp(argv[i], "--json") == 0) {
+      json_path = argv[++i];
+    } else if (isDirectory(argv[i])) {
+      walkDirectory(argv[i], visitFile, &files);
+    } else {
+      addFile(&files, argv[i]);
+    }
+  }
+  if (threads < 1 || files.count == 0) {
+    fprintf(stderr, "usage: minesweeper-analyse [--threads n] [--csv file] [--json file] path...\n");
+    return 1;
+  }
+
+  Shared shared = {.files = &files};
+  atomic_init(&shared.next, 0);
+  if (csv_path) {
+    shared.csv = fopen(csv_path, "w");
+    if (!shared.csv) {
+      fprintf(stderr, "cannot write %s\n", csv_path);
+      return 1;
+    }
+    fprintf(shared.csv, "file,width,height,mines,outcome,seconds,3bv,3bv_per_second,clicks,efficiency\n");
+  }
+  mtx_init(&shared.csv_lock, mtx_plain);
+
+  AnalyseWorker *workers = calloc(threads, sizeof(AnalyseWorker));
+  thrd_t *handles = malloc(sizeof(thrd_t) * threads);
+  bool *started = malloc(sizeof(bool) * threads);
+  const uint64_t start = getNanoseconds();
+  for (int i = 0; i < threads; ++i) {
+    workers[i].shared = &shared;
+    started[i] = thrd_create(&handles[i], analyseWorker, &workers[i]) == thrd_success;
+  }
+  // A worker that couldn't be started takes batches from the shared queue on this thread alongside the others, with the
+  // thread's own engine state put back after
+  for (int i = 0; i < threads; ++i) {
+    if (!started[i]) {
+      EngineState state;
+      saveEngineState(&state);
+      analyseWorker(&workers[i]);
+      restoreEngineState(&state);
+    }
+  }
+  for (int i = 0; i < threads; ++i) {
+    if (started[i]) {
+      thrd_join(handles[i], NULL);
+    }
+  }
+  free(started);
+  const double seconds = (getNanoseconds() - start) * 1e-9;
+
+  Groups groups = {0};
+  uint64_t invalid = 0;
+  uint64_t bytes = 0;
+  for (int i = 0; i < threads; ++i) {
+    for (int g = 0; g < workers[i].groups.count; ++g) {
+      mergeGroup(&groups, &workers[i].groups.groups[g]);
+    }
+    invalid += workers[i].invalid;
+    bytes += workers[i].bytes;
+    free(workers[i].groups.groups);
+  }
+  qsort(groups.groups, groups.count, sizeof(BoardGroup), compareGroups);
+
+  printf("%zu replays (%llu invalid) on %d threads\n", files.count, (unsigned long long)invalid, threads);
+  printf("time: %.3f s (%.0f replays/s, %.1f MB/s)\n", seconds, files.count / seconds, bytes / seconds * 1e-6);
+  for (int i = 0; i < groups.count; ++i) {
+    const BoardGroup *group = &groups.groups[i];
+    const uint64_t won = group->games[OUTCOME_WON];
+    const uint64_t games = won + group->games[OUTCOME_LOST] + group->games[OUTCOME_ABANDONED];
+    printf("%dx%d, %d mines: %llu games, %llu won (%.1f%%), %llu lost, %llu abandoned\n", group->width, group->height, group->mines,
+           (unsigned long long)games, (unsigned long long)won, 100.0 * won / games, (unsigned long long)group->games[OUTCOME_LOST],
+           (unsigned long long)group->games[OUTCOME_ABANDONED]);
+    if (won > 0) {
+      printf("  won: mean %.2f s (best %.2f s), 3BV %.1f, 3BV/s %.3f (best %.3f), clicks %.1f, efficiency %.1f%%\n", group->seconds / won,
+             group->best_seconds, (double)group->bbbv / won, group->bbbv_per_second / won, group->best_bbbv_per_second,
+             (double)group->clicks / won, 100.0 * group->efficiency / won);
+    }
+  }
+
+  bool failed = false;
+  if (json_path) {
+    FILE *json = fopen(json_path, "w");
+    if (json) {
+      writeJson(json, &groups, invalid, files.count, seconds);
+      failed |= fclose(json) != 0;
+    } else {
+      fprintf(stderr, "cannot write %s\n", json_path);
+      failed = true;
+    }
+  }
+  if (shared.csv) {
+    failed |= fclose(shared.csv) != 0;
+  }
+  mtx_destroy(&shared.csv_lock);
+  free(groups.groups);
+  free(handles);
+  free(workers);
+  free(files.offsets);
+  free(files.names);
+  return failed;
+}
@@ -0,0 +1,232 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+#include "timing.h"
+#include "view.h"
+
+typedef struct BenchContext {
+  int width;
+  int height;
+  int mines;
+  double density;
+  uint8_t *layout;       // generated board, everything closed
+  uint8_t *chord_layout; // layout with an open number cell whose mines are flagged
+  uint8_t *board;        // working copy the timed operation runs on
+  CellChanges changes;   // room for a change per cell, for the cases that record them
+  int start_x;
+  int start_y;
+  int chord_x;
+  int chord_y;
+} BenchContext;
+
+typedef struct BenchCase {
+  const char *name;
+  void (*setup)(BenchContext *context); // untimed, before every repetition
+  void (*run)(BenchContext *context);
+  int batch; // calls per timed repetition, for operations too fast to time one by one
+} BenchCase;
+
+static volatile int bench_sink;
+
+static void setupNone(BenchContext *context) {}
+static void setupEmpty(BenchContext *context) { resetGame(context->board); }
+static void setupLayout(BenchContext *context) {
+  memcpy(context->board, context->layout, sizeof(uint8_t) * context->width * context->height);
+  opened_cells = 0;
+}
+static void setupChord(BenchContext *context) {
+  memcpy(context->board, context->chord_layout, sizeof(uint8_t) * context->width * context->height);
+  opened_cells = 1;
+}
+
+static void runResetGame(BenchContext *context) { resetGame(context->board); }
+static void runGenerateMines(BenchContext *context) { generateMines(context->board, context->start_x, context->start_y); }
+static void runOpenCell(BenchContext *context) { bench_sink = openCell(context->board, context->start_x, context->start_y); }
+static void runOpenNeighbors(BenchContext *context) { bench_sink = openNeighbors(context->board, context->chord_x, context->chord_y); }
+static void runCheckWin(BenchContext *context) { bench_sink = checkWin(context->board); }
+static void runRevealMines(BenchContext *context) { revealMines(context->board); }
+// Same operations with the changes recorded, the difference is what a consumer of the change stream costs the engine
+static void runOpenCellChanges(BenchContext *context) {
+  context->changes.count = 0;
+  cell_changes = &context->changes;
+  bench_sink = openCell(context->board, context->start_x, context->start_y);
+  cell_changes = NULL;
+}
+static void runRevealMinesChanges(BenchContext *context) {
+  context->changes.count = 0;
+  cell_changes = &context->changes;
+  revealMines(context->board);
+  cell_changes = NULL;
+}
+static void runFindCollisionCell(BenchContext *context) {
+  // Bottom right cell, the last one the scan reaches
+  const Vector2 mouse_pos = {20.0f + (context->width - 1) * 20.0f + 10.0f, 90.0f + (context->height - 1) * 20.0f + 10.0f};
+  int x, y;
+  bench_sink = findCollisionCell(mouse_pos, (Vector2){20.0f, 90.0f}, &x, &y);
+}
+
+static const BenchCase bench_cases[] = {
+    {"resetGame", setupNone, runResetGame, 1},
+    {"generateMines", setupEmpty, runGenerateMines, 1},
+    {"openCell", setupLayout, runOpenCell, 1},
+    {"openCell+changes", setupLayout, runOpenCellChanges, 1},
+    {"openNeighbors", setupChord, runOpenNeighbors, 1},
+    {"checkWin", setupLayout, runCheckWin, 1024},
+    {"revealMines", setupLayout, runRevealMines, 1},
+    {"revealMines+changes", setupLayout, runRevealMinesChanges, 1},
+    {"findCollisionCell", setupNone, runFindCollisionCell, 1},
+};
+
+static int compareDoubles(const void *a, const void *b) {
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Generates the layouts every case starts from. Fixed seed, so every commit benchmarks the same boards.
+static void prepareContext(BenchContext *context) {
+  const int cells = context->width * context->height;
+  board_width = context->width;
+  board_height = context->height;
+  num_mines = context->mines;
+  context->layout = malloc(sizeof(uint8_t) * cells);
+  context->chord_layout = malloc(sizeof(uint8_t) * cells);
+  context->board = malloc(sizeof(uint8_t) * cells);
+  context->changes = (CellChanges){malloc(sizeof(CellChange) * cells), cells, 0, 0};
+  context->start_x = context->width / 2;
+  context->start_y = context->height / 2;
+
+  seedRandom(1);
+  resetGame(context->layout);
+  generateMines(context->layout, context->start_x, context->start_y);
+
+  // Chord on the first number cell in row order, with its mines flagged
+  memcpy(context->chord_layout, context->layout, sizeof(uint8_t) * cells);
+  uint8_t *board = context->chord_layout;
+  context->chord_x = context->start_x;
+  context->chord_y = context->start_y;
+  for (int cell = 0; cell < cells; ++cell) {
+    const uint8_t number = getNumber(board[cell]);
+    if (number == 0 || number == 9) {
+      continue;
+    }
+    context->chord_x = cell % context->width;
+    context->chord_y = cell / context->width;
+    break;
+  }
+  BOARD(context->chord_x, context->chord_y) = setDisplayState(BOARD(context->chord_x, context->chord_y), cell_display_state_open);
+  for (int y = context->chord_y - 1; y <= context->chord_y + 1; ++y) {
+    for (int x = context->chord_x - 1; x <= context->chord_x + 1; ++x) {
+      if (x >= 0 && x < context->width && y >= 0 && y < context->height && getNumber(BOARD(x, y)) == 9) {
+        BOARD(x, y) = setDisplayState(BOARD(x, y), cell_display_state_flagged);
+      }
+    }
+  }
+}
+
+static void freeContext(BenchContext *context) {
+  free(context->layout);
+  free(context->chord_layout);
+  free(context->board);
+  free(context->changes.changes);
+}
+
+// minesweeper-bench [--quick] [--out file.json]
+// Times the engine's hot paths over a grid of board sizes and densities. Human readable results go to stderr, JSON (one
+// object per case with median and p99 in nanoseconds) to the file or stdout, so runs can be diffed between commits.
+int main(int argc, char **argv) {
+  bool quick = false;
+  const char *out_path = NULL;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--quick") == 0) {
+      quick = true;
+    } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      out_path = argv[++i];
+    } else {
+      fprintf(stderr, "usage: minesweeper-bench [--quick] [--out file.json]\n");
+      return 1;
+    }
+  }
+  FILE *out = out_path ? fopen(out_path, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "cannot write %s\n", out_path);
+    return 1;
+  }
+
+  const int sizes[][2] = {{9, 9}, {16, 16}, {30, 16}, {100, 100}, {1000, 1000}, {4000, 4000}};
+  const double densities[] = {0.05, 0.10, 0.20, 0.40};
+  const int num_sizes = quick ? 5 : sizeof(sizes) / sizeof(sizes[0]);
+  // Per case: time spent warming up, time spent measuring, and bounds on the repetitions
+  const double warmup_seconds = quick ? 0.005 : 0.02;
+  const double measure_seconds = quick ? 0.02 : 0.2;
+  const int min_repetitions = 5;
+  const int max_repetitions = quick ? 200 : 2000;
+  double *samples = malloc(sizeof(double) * max_repetitions);
+
+  fprintf(out, "{\n  \"benchmark\": \"engine\",\n  \"quick\": %s,\n  \"results\": [", quick ? "true" : "false");
+  fprintf(stderr, "%-20s %11s %8s %6s %14s %14s\n", "operation", "board", "density", "reps", "median ns", "p99 ns");
+  bool first_result = true;
+  for (int s = 0; s < num_sizes; ++s) {
+    for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); ++d) {
+      BenchContext context = {.width = sizes[s][0], .height = sizes[s][1], .density = densities[d]};
+      const int cells = context.width * context.height;
+      context.mines = (int)lround(cells * densities[d]);
+      if (context.mines > cells - 9) {
+        context.mines = cells - 9;
+      }
+      prepareContext(&context);
+
+      for (size_t c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); ++c) {
+        const BenchCase *bench_case = &bench_cases[c];
+        const uint64_t warmup_end = getNanoseconds() + (uint64_t)(warmup_seconds * 1e9);
+        do {
+          bench_case->setup(&context);
+          for (int i = 0; i < bench_case->batch; ++i) {
+            bench_case->run(&context);
+          }
+        } while (getNanoseconds() < warmup_end);
+
+        int repetitions = 0;
+        const uint64_t measure_end = getNanoseconds() + (uint64_t)(measure_seconds * 1e9);
+        while (repetitions < max_repetitions && (repetitions < min_repetitions || getNanoseconds() < measure_end)) {
+          bench_case->setup(&context);
+          const uint64_t start = getNanoseconds();
+          for (int i = 0; i < bench_case->batch; ++i) {
+            bench_case->run(&context);
+          }
+          samples[repetitions++] = (double)(getNanoseconds() - start) / bench_case->batch;
+        }
+
+        qsort(samples, repetitions, sizeof(double), compareDoubles);
+        double mean = 0.0;
+        for (int i = 0; i < repetitions; ++i) {
+          mean += samples[i];
+        }
+        mean /= repetitions;
+        const double median = samples[repetitions / 2];
+        const double p99 = samples[(int)ceil(repetitions * 0.99) - 1];
+
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", context.width, context.height);
+        fprintf(stderr, "%-20s %11s %7.0f%% %6d %14.1f %14.1f\n", bench_case->name, size, densities[d] * 100.0, repetitions, median, p99);
+        fprintf(out,
+                "%s\n    {\"name\": \"%s\", \"width\": %d, \"height\": %d, \"mines\": %d, \"density\": %.2f, \"repetitions\": %d, "
+                "\"batch\": %d, \"median_ns\": %.1f, \"p99_ns\": %.1f, \"min_ns\": %.1f, \"mean_ns\": %.1f}",
+                first_result ? "" : ",", bench_case->name, context.width, context.height, context.mines, densities[d], repetitions,
+                bench_case->batch, median, p99, samples[0], mean);
+        first_result = false;
+      }
+      freeContext(&context);
+    }
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  free(samples);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
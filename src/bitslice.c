@@ -0,0 +1,208 @@
+#include "bitslice.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+
+void bitsliceInit(BitsliceBoards *boards, int width, int height) {
+  const int cells = width * height;
+  boards->width = width;
+  boards->height = height;
+  boards->mine = malloc(sizeof(uint64_t) * cells);
+  for (int i = 0; i < 4; ++i) {
+    boards->number[i] = malloc(sizeof(uint64_t) * cells);
+  }
+  boards->open = malloc(sizeof(uint64_t) * cells);
+  boards->flagged = malloc(sizeof(uint64_t) * cells);
+  boards->mistake = malloc(sizeof(uint64_t) * cells);
+  boards->pending = calloc(cells, sizeof(uint64_t));
+  boards->stack = malloc(sizeof(int32_t) * cells);
+
+  boards->neighbors = malloc(sizeof(int32_t) * 8 * cells);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      int32_t *neighbors = &boards->neighbors[(y * width + x) * 8];
+      int count = 0;
+      for (int ny = y - 1; ny <= y + 1; ++ny) {
+        for (int nx = x - 1; nx <= x + 1; ++nx) {
+          if ((nx != x || ny != y) && nx >= 0 && nx < width && ny >= 0 && ny < height) {
+            neighbors[count++] = ny * width + nx;
+          }
+        }
+      }
+      while (count < 8) {
+        neighbors[count++] = -1;
+      }
+    }
+  }
+  bitsliceClear(boards);
+}
+
+void bitsliceFree(BitsliceBoards *boards) {
+  free(boards->mine);
+  for (int i = 0; i < 4; ++i) {
+    free(boards->number[i]);
+  }
+  free(boards->open);
+  free(boards->flagged);
+  free(boards->mistake);
+  free(boards->neighbors);
+  free(boards->pending);
+  free(boards->stack);
+  *boards = (BitsliceBoards){0};
+}
+
+void bitsliceClear(BitsliceBoards *boards) {
+  const size_t size = sizeof(uint64_t) * boards->width * boards->height;
+  memset(boards->mine, 0, size);
+  for (int i = 0; i < 4; ++i) {
+    memset(boards->number[i], 0, size);
+  }
+  memset(boards->open, 0, size);
+  memset(boards->flagged, 0, size);
+  memset(boards->mistake, 0, size);
+}
+
+void bitsliceSetLane(BitsliceBoards *boards, int lane, const uint8_t *board) {
+  const uint64_t bit = (uint64_t)1 << lane;
+  for (int cell = 0; cell < boards->width * boards->height; ++cell) {
+    const uint8_t number = getNumber(board[cell]);
+    const uint8_t state = getDisplayState(board[cell]);
+    boards->mine[cell] = (boards->mine[cell] & ~bit) | (number == 9 ? bit : 0);
+    for (int i = 0; i < 4; ++i) {
+      boards->number[i][cell] = (boards->number[i][cell] & ~bit) | ((number >> i) & 1 ? bit : 0);
+    }
+    boards->open[cell] = (boards->open[cell] & ~bit) | (state == cell_display_state_open ? bit : 0);
+    boards->flagged[cell] = (boards->flagged[cell] & ~bit) | (state == cell_display_state_flagged ? bit : 0);
+    boards->mistake[cell] = (boards->mistake[cell] & ~bit) | (state == cell_display_state_mistake ? bit : 0);
+  }
+}
+
+void bitsliceGetLane(const BitsliceBoards *boards, int lane, uint8_t *board) {
+  for (int cell = 0; cell < boards->width * boards->height; ++cell) {
+    uint8_t number = 0;
+    for (int i = 0; i < 4; ++i) {
+      number |= ((boards->number[i][cell] >> lane) & 1) << i;
+    }
+    uint8_t state = cell_display_state_closed;
+    if ((boards->open[cell] >> lane) & 1) {
+      state = cell_display_state_open;
+    } else if ((boards->flagged[cell] >> lane) & 1) {
+      state = cell_display_state_flagged;
+    } else if ((boards->mistake[cell] >> lane) & 1) {
+      state = cell_display_state_mistake;
+    }
+    board[cell] = setDisplayState(number, state);
+  }
+}
+
+void bitsliceComputeNumbers(BitsliceBoards *boards) {
+  for (int cell = 0; cell < boards->width * boards->height; ++cell) {
+    // 4 bit counter per lane, each neighbor mine goes through a ripple carry adder
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    const int32_t *neighbors = &boards->neighbors[cell * 8];
+    for (int i = 0; i < 8 && neighbors[i] >= 0; ++i) {
+      const uint64_t mine = boards->mine[neighbors[i]];
+      const uint64_t c0 = s0 & mine;
+      s0 ^= mine;
+      const uint64_t c1 = s1 & c0;
+      s1 ^= c0;
+      const uint64_t c2 = s2 & c1;
+      s2 ^= c1;
+      s3 |= c2;
+    }
+    // Mines read 9 (0b1001)
+    const uint64_t mine = boards->mine[cell];
+    boards->number[0][cell] = (s0 & ~mine) | mine;
+    boards->number[1][cell] = s1 & ~mine;
+    boards->number[2][cell] = s2 & ~mine;
+    boards->number[3][cell] = (s3 & ~mine) | mine;
+  }
+}
+
+void bitsliceGenerate(BitsliceBoards *boards, const int32_t *start_cells) {
+  uint8_t *board = malloc(sizeof(uint8_t) * boards->width * boards->height);
+  for (int lane = 0; lane < BITSLICE_LANES; ++lane) {
+    if (start_cells[lane] < 0) {
+      continue;
+    }
+    memset(board, 0, sizeof(uint8_t) * boards->width * boards->height);
+    generateMines(board, start_cells[lane] % boards->width, start_cells[lane] / boards->width);
+    // Only the mines are taken over, the numbers are recomputed for all lanes at once below
+    const uint64_t bit = (uint64_t)1 << lane;
+    for (int cell = 0; cell < boards->width * boards->height; ++cell) {
+      boards->mine[cell] = (boards->mine[cell] & ~bit) | (getNumber(board[cell]) == 9 ? bit : 0);
+      boards->open[cell] &= ~bit;
+      boards->flagged[cell] &= ~bit;
+      boards->mistake[cell] &= ~bit;
+    }
+  }
+  free(board);
+  bitsliceComputeNumbers(boards);
+}
+
+static inline uint64_t closedLanes(const BitsliceBoards *boards, int cell) {
+  return ~(boards->open[cell] | boards->flagged[cell] | boards->mistake[cell]);
+}
+
+static inline uint64_t zeroLanes(const BitsliceBoards *boards, int cell) {
+  return ~(boards->number[0][cell] | boards->number[1][cell] | boards->number[2][cell] | boards->number[3][cell]);
+}
+
+uint64_t bitsliceOpen(BitsliceBoards *boards, const int32_t *cells) {
+  uint64_t hit = 0;
+  int stack_size = 0;
+  for (int lane = 0; lane < BITSLICE_LANES; ++lane) {
+    const int cell = cells[lane];
+    const uint64_t bit = (uint64_t)1 << lane;
+    if (cell < 0 || !(closedLanes(boards, cell) & bit)) {
+      continue;
+    }
+    if (boards->mine[cell] & bit) {
+      boards->mistake[cell] |= bit;
+      hit |= bit;
+      continue;
+    }
+    boards->open[cell] |= bit;
+    if (zeroLanes(boards, cell) & bit) {
+      if (!boards->pending[cell]) {
+        boards->stack[stack_size++] = cell;
+      }
+      boards->pending[cell] |= bit;
+    }
+  }
+
+  // Flood fill on every lane at once: a zero cell opens its closed neighbors (which are never mines), zero ones among them
+  // carry on. The opened area does not depend on the order cells are visited in, so this matches the recursive openCell.
+  while (stack_size > 0) {
+    const int cell = boards->stack[--stack_size];
+    const uint64_t lanes = boards->pending[cell];
+    boards->pending[cell] = 0;
+    const int32_t *neighbors = &boards->neighbors[cell * 8];
+    for (int i = 0; i < 8 && neighbors[i] >= 0; ++i) {
+      const int neighbor = neighbors[i];
+      const uint64_t opened = lanes & closedLanes(boards, neighbor);
+      if (!opened) {
+        continue;
+      }
+      boards->open[neighbor] |= opened;
+      const uint64_t spread = opened & zeroLanes(boards, neighbor);
+      if (spread) {
+        if (!boards->pending[neighbor]) {
+          boards->stack[stack_size++] = neighbor;
+        }
+        boards->pending[neighbor] |= spread;
+      }
+    }
+  }
+  return hit;
+}
+
+uint64_t bitsliceWon(const BitsliceBoards *boards) {
+  uint64_t won = ~(uint64_t)0;
+  for (int cell = 0; cell < boards->width * boards->height; ++cell) {
+    won &= boards->mine[cell] | boards->open[cell];
+  }
+  return won;
+}
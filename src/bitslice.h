@@ -0,0 +1,46 @@
+#ifndef BITSLICE_H
+#define BITSLICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// 64 boards of the same size played side by side for simulation. Every plane holds one word per cell and bit i of each word
+// belongs to board (lane) i, so neighbor counting and flood fill run on all 64 boards with the same bitwise operations.
+// Results match the scalar engine exactly: lanes can be copied in from and out to the usual byte per cell layout.
+#define BITSLICE_LANES 64
+
+typedef struct BitsliceBoards {
+  int width;
+  int height;
+
+  uint64_t *mine;
+  uint64_t *number[4]; // bits of the number nibble, 9 on mines like the scalar board
+  uint64_t *open;
+  uint64_t *flagged;
+  uint64_t *mistake;
+
+  int32_t *neighbors; // 8 per cell, -1 past the edge
+  uint64_t *pending;  // flood fill: lanes where the cell still has to open its neighbors
+  int32_t *stack;
+} BitsliceBoards;
+
+void bitsliceInit(BitsliceBoards *boards, int width, int height);
+void bitsliceFree(BitsliceBoards *boards);
+// All lanes closed and without mines
+void bitsliceClear(BitsliceBoards *boards);
+
+void bitsliceSetLane(BitsliceBoards *boards, int lane, const uint8_t *board);
+void bitsliceGetLane(const BitsliceBoards *boards, int lane, uint8_t *board);
+
+// Numbers of every lane from its mines
+void bitsliceComputeNumbers(BitsliceBoards *boards);
+// Runs generateMines once per lane (so the engine's board size must match) and computes the numbers bitsliced.
+// start_cells[lane] < 0 leaves the lane untouched.
+void bitsliceGenerate(BitsliceBoards *boards, const int32_t *start_cells);
+
+// openCell on every lane with cells[lane] >= 0, returns the lanes that hit a mine
+uint64_t bitsliceOpen(BitsliceBoards *boards, const int32_t *cells);
+// Lanes with every safe cell open
+uint64_t bitsliceWon(const BitsliceBoards *boards);
+
+#endif
@@ -0,0 +1,134 @@
+#include "bot.h"
+
+#include <stdlib.h>
+
+#include "engine.h"
+#include "memtrack.h"
+
+void botReset(Bot *bot) {
+  bot->solving = false;
+  bot->queue_head = 0;
+  bot->queue_length = 0;
+  bot->moves = 0;
+  bot->guesses = 0;
+}
+
+static void queueCells(Bot *bot, const int32_t *cells, int count, bool mines) {
+  // Kept across games like the solver's arrays, so growing it is exempt from the hot path checks
+  if (bot->queue_length + count > bot->queue_capacity) {
+    bot->queue_capacity = (bot->queue_length + count) * 2;
+    const bool hot = memSetHotPath(false);
+    bot->queue = memRealloc(MEM_BOT, bot->queue, sizeof(int32_t) * bot->queue_capacity);
+    memSetHotPath(hot);
+  }
+  for (int i = 0; i < count; ++i) {
+    bot->queue[bot->queue_length++] = mines ? -(cells[i] + 1) : cells[i];
+  }
+}
+
+// Open number next to (x, y) that already has all of its mines flagged, so a chord opens (x, y) and anything else around it
+static bool findChord(uint8_t *board, int x, int y, int *out_x, int *out_y) {
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      const int nx = x + dx;
+      const int ny = y + dy;
+      if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= board_width || ny >= board_height) {
+        continue;
+      }
+      if (getDisplayState(BOARD(nx, ny)) != cell_display_state_open || getNumber(BOARD(nx, ny)) == 0) {
+        continue;
+      }
+      int flagged = 0;
+      for (int fy = ny - 1; fy <= ny + 1; ++fy) {
+        for (int fx = nx - 1; fx <= nx + 1; ++fx) {
+          if (fx >= 0 && fy >= 0 && fx < board_width && fy < board_height &&
+              getDisplayState(BOARD(fx, fy)) == cell_display_state_flagged) {
+            ++flagged;
+          }
+        }
+      }
+      if (flagged == getNumber(BOARD(nx, ny))) {
+        *out_x = nx;
+        *out_y = ny;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Plays the next queued cell that still needs playing, false if the queue ran dry
+static bool playQueued(Bot *bot, uint8_t *board) {
+  while (bot->queue_head < bot->queue_length) {
+    const int32_t entry = bot->queue[bot->queue_head++];
+    const bool mine = entry < 0;
+    const int cell = mine ? -entry - 1 : entry;
+    const int x = cell % board_width;
+    const int y = cell / board_width;
+    if (getDisplayState(board[cell]) != cell_display_state_closed) {
+      continue;
+    }
+    if (mine) {
+      playFlag(board, x, y);
+    } else {
+      int chord_x, chord_y;
+      if (findChord(board, x, y, &chord_x, &chord_y)) {
+        playChord(board, chord_x, chord_y);
+      } else {
+        playOpen(board, x, y);
+      }
+    }
+    ++bot->moves;
+    return true;
+  }
+  bot->queue_head = 0;
+  bot->queue_length = 0;
+  return false;
+}
+
+BotStatus botStep(Bot *bot, uint8_t *board, double budget_seconds) {
+  if (!game_running) {
+    return BOT_IDLE;
+  }
+  if (is_first_open) {
+    // The first click is safe unless the policy says otherwise, the middle of the board is the most likely to open an area
+    playOpen(board, board_width / 2, board_height / 2);
+    ++bot->moves;
+    bot->guesses += first_click_policy == FIRST_CLICK_ANY;
+    return BOT_MOVED;
+  }
+  if (playQueued(bot, board)) {
+    return BOT_MOVED;
+  }
+
+  if (!bot->solving) {
+    solverStart(&bot->solver, board, board_width, board_height, num_mines);
+    bot->solving = true;
+  }
+  if (!solverStep(&bot->solver, budget_seconds)) {
+    return BOT_THINKING;
+  }
+  bot->solving = false;
+
+  // Flags first so the safe cells after them can be opened with chords
+  queueCells(bot, bot->solver.mine_cells, bot->solver.num_mines_found, true);
+  queueCells(bot, bot->solver.safe_cells, bot->solver.num_safe, false);
+  if (playQueued(bot, board)) {
+    return BOT_MOVED;
+  }
+
+  const int cell = bot->solver.result.cell;
+  if (cell < 0) {
+    return BOT_IDLE;
+  }
+  playOpen(board, cell % board_width, cell / board_width);
+  ++bot->moves;
+  ++bot->guesses;
+  return BOT_MOVED;
+}
+
+void botFree(Bot *bot) {
+  solverFree(&bot->solver);
+  memFree(bot->queue);
+  *bot = (Bot){0};
+}
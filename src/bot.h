@@ -0,0 +1,34 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "solver.h"
+
+typedef enum BotStatus {
+  BOT_MOVED,    // made one move
+  BOT_THINKING, // solver ran out of budget, call again
+  BOT_IDLE      // game is not running
+} BotStatus;
+
+// Plays the current board through playOpen/playChord/toggleFlagged like a player would. Proven mines and safe cells from
+// one solve are queued and played one move at a time, the solver is only run again once the queue is empty.
+typedef struct Bot {
+  Solver solver;
+  bool solving;
+  int32_t *queue; // cells, mines (to flag) are stored as -(cell + 1)
+  int queue_head;
+  int queue_length;
+  int queue_capacity;
+
+  uint64_t moves;
+  uint64_t guesses;
+} Bot;
+
+void botReset(Bot *bot);
+// budget_seconds bounds solver time per call, <= 0 to solve to completion
+BotStatus botStep(Bot *bot, uint8_t *board, double budget_seconds);
+void botFree(Bot *bot);
+
+#endif
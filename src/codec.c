@@ -0,0 +1,128 @@
+#include "codec.h"
+
+#include "engine.h"
+
+void bufferReserve(ByteBuffer *buffer, MemCategory category, size_t extra) {
+  if (buffer->size + extra <= buffer->capacity) {
+    return;
+  }
+  size_t capacity = buffer->capacity > 0 ? buffer->capacity : 1024;
+  while (capacity < buffer->size + extra) {
+    capacity *= 2;
+  }
+  buffer->data = memRealloc(category, buffer->data, capacity);
+  buffer->capacity = capacity;
+}
+
+void putVarint(ByteBuffer *buffer, uint64_t value) {
+  while (value >= 0x80) {
+    buffer->data[buffer->size++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  buffer->data[buffer->size++] = (uint8_t)value;
+}
+
+uint64_t getVarint(ByteReader *reader) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64 && !reader->failed; shift += 7) {
+    if (reader->offset >= reader->size) {
+      break;
+    }
+    const uint8_t byte = reader->data[reader->offset++];
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  reader->failed = true;
+  return 0;
+}
+
+void putDisplayStates(ByteBuffer *buffer, MemCategory category, const uint8_t *board, int cells) {
+  for (int i = 0; i < cells;) {
+    const uint8_t state = getDisplayState(board[i]);
+    int run = 1;
+    while (i + run < cells && getDisplayState(board[i + run]) == state) {
+      ++run;
+    }
+    bufferReserve(buffer, category, 10);
+    putVarint(buffer, ((uint64_t)(run - 1) << 3) | state);
+    i += run;
+  }
+}
+
+void getDisplayStates(ByteReader *reader, uint8_t *board, int cells) {
+  for (int i = 0; i < cells && !reader->failed;) {
+    const uint64_t run = getVarint(reader);
+    const uint8_t state = run & 7;
+    const int end = (run >> 3) < (uint64_t)(cells - i) ? i + (int)(run >> 3) + 1 : cells;
+    for (; i < end; ++i) {
+      board[i] = setDisplayState(board[i], state);
+    }
+  }
+}
+
+static void putBits(BitWriter *writer, uint32_t value, int count) {
+  writer->bits |= value << writer->count;
+  writer->count += count;
+  while (writer->count >= 8) {
+    bufferReserve(writer->buffer, writer->category, 1);
+    writer->buffer->data[writer->buffer->size++] = (uint8_t)writer->bits;
+    writer->bits >>= 8;
+    writer->count -= 8;
+  }
+}
+
+void putRice(BitWriter *writer, uint64_t value, int k) {
+  for (uint64_t quotient = value >> k; quotient > 0;) {
+    const int ones = quotient > 16 ? 16 : (int)quotient;
+    putBits(writer, (1u << ones) - 1, ones);
+    quotient -= ones;
+  }
+  putBits(writer, 0, 1);
+  if (k > 0) {
+    putBits(writer, (uint32_t)(value & ((1u << k) - 1)), k);
+  }
+}
+
+void flushBits(BitWriter *writer) {
+  if (writer->count > 0) {
+    putBits(writer, 0, 8 - writer->count);
+  }
+}
+
+static uint32_t getBit(BitReader *reader) {
+  if (reader->count == 0) {
+    ByteReader *bytes = reader->reader;
+    if (bytes->offset >= bytes->size) {
+      bytes->failed = true;
+      return 0;
+    }
+    reader->bits = bytes->data[bytes->offset++];
+    reader->count = 8;
+  }
+  const uint32_t bit = reader->bits & 1;
+  reader->bits >>= 1;
+  --reader->count;
+  return bit;
+}
+
+uint64_t getRice(BitReader *reader, int k) {
+  uint64_t quotient = 0;
+  while (getBit(reader)) {
+    ++quotient;
+  }
+  uint64_t value = quotient << k;
+  for (int i = 0; i < k; ++i) {
+    value |= (uint64_t)getBit(reader) << i;
+  }
+  return reader->reader->failed ? 0 : value;
+}
+
+int riceParameter(double mean) {
+  int k = 0;
+  while (k < 24 && (double)(2u << k) <= mean) {
+    ++k;
+  }
+  return k;
+}
@@ -0,0 +1,63 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "memtrack.h"
+
+// Byte level helpers shared by the replay and saved game formats
+
+// Grows by doubling, so appending only allocates now and then
+typedef struct ByteBuffer {
+  uint8_t *data;
+  size_t size;
+  size_t capacity;
+} ByteBuffer;
+
+typedef struct ByteReader {
+  const uint8_t *data;
+  size_t size;
+  size_t offset;
+  bool failed; // set by reading past the end or a malformed value, reads return 0 from then on
+} ByteReader;
+
+void bufferReserve(ByteBuffer *buffer, MemCategory category, size_t extra);
+
+// At most 10 bytes, the caller reserves them
+void putVarint(ByteBuffer *buffer, uint64_t value);
+uint64_t getVarint(ByteReader *reader);
+
+static inline uint64_t zigzag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+
+static inline int64_t unzigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+// Display states of cells board[0..cells) as runs, each one varint of the run length minus 1 shifted past the 3 state
+// bits. getDisplayStates keeps the number nibbles.
+void putDisplayStates(ByteBuffer *buffer, MemCategory category, const uint8_t *board, int cells);
+void getDisplayStates(ByteReader *reader, uint8_t *board, int cells);
+
+// Golomb-Rice codes: value >> k in unary, then its low k bits. Close to the entropy of geometrically distributed values,
+// such as the gaps between randomly placed mines, when 2^k is near their mean. Bits are packed from the low end of each byte.
+typedef struct BitWriter {
+  ByteBuffer *buffer;
+  MemCategory category;
+  uint32_t bits;
+  int count;
+} BitWriter;
+
+typedef struct BitReader {
+  ByteReader *reader;
+  uint32_t bits;
+  int count;
+} BitReader;
+
+void putRice(BitWriter *writer, uint64_t value, int k);
+// Pads the last byte with zeros
+void flushBits(BitWriter *writer);
+uint64_t getRice(BitReader *reader, int k);
+// k for values with the given mean
+int riceParameter(double mean);
+
+#endif
@@ -0,0 +1,621 @@
+#include "engine.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "memtrack.h"
+#include "nogen.h"
+#include "replay.h"
+#include "trace.h"
+
+// beginner, intermediate, expert
+// board_width, board_height, num_mines
+int difficulty_nums[] = {9, 9, 10, 16, 16, 40, 30, 16, 99};
+
+thread_local int board_width = 9;
+thread_local int board_height = 9;
+thread_local int num_mines = 10;
+thread_local int mines_left = 10;
+
+thread_local uint32_t timer = 0;
+thread_local bool timer_running = false;
+thread_local bool game_running = true;
+thread_local bool is_first_open = true;
+thread_local bool game_over = false;
+thread_local bool game_won = false;
+
+thread_local uint32_t board_revision = 0;
+thread_local int opened_cells = 0;
+thread_local bool no_guess = false;
+thread_local FirstClickPolicy first_click_policy = FIRST_CLICK_OPENING;
+thread_local CellChanges *cell_changes = NULL;
+thread_local bool board_seeded = false;
+thread_local BoardId board_id = {0};
+
+static thread_local EngineCounters counters = {0};
+
+// Scratch kept between calls: flood fill stack, column mine counts for computeNumbers and the mine placement tree
+static thread_local int32_t *flood_stack = NULL;
+static thread_local int flood_capacity = 0;
+static thread_local uint8_t *column_scratch = NULL;
+static thread_local int column_capacity = 0;
+static thread_local int32_t *tree_scratch = NULL;
+static thread_local int tree_capacity = 0;
+
+// Floods of more cells than this grow the stack when they get that deep instead of reserving it for every board
+#define FLOOD_RESERVE (1 << 20)
+// Cells per leaf of the mine placement tree
+#define MINE_BLOCK_SIZE 64
+
+static void *growScratch(void *scratch, int *capacity, int needed, size_t size) {
+  if (needed <= *capacity) {
+    return scratch;
+  }
+  *capacity = needed;
+  return memRealloc(MEM_ENGINE, scratch, size * needed);
+}
+
+void reserveEngineScratch(int width, int height) {
+  const int cells = width * height;
+  flood_stack = growScratch(flood_stack, &flood_capacity, cells < FLOOD_RESERVE ? cells : FLOOD_RESERVE, sizeof(int32_t));
+  column_scratch = growScratch(column_scratch, &column_capacity, width + 2, sizeof(uint8_t));
+  tree_scratch = growScratch(tree_scratch, &tree_capacity, (cells + MINE_BLOCK_SIZE - 1) / MINE_BLOCK_SIZE + 1, sizeof(int32_t));
+}
+
+void freeEngineScratch(void) {
+  memFree(flood_stack);
+  memFree(column_scratch);
+  memFree(tree_scratch);
+  flood_stack = NULL;
+  column_scratch = NULL;
+  tree_scratch = NULL;
+  flood_capacity = column_capacity = tree_capacity = 0;
+}
+
+// xoshiro256**, seeded through splitmix64
+static thread_local uint64_t rng_state[4] = {0x9E3779B97F4A7C15u, 0xBF58476D1CE4E5B9u, 0x94D049BB133111EBu, 0x2545F4914F6CDD1Du};
+
+static inline uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+void saveEngineState(EngineState *state) {
+  state->board_width = board_width;
+  state->board_height = board_height;
+  state->num_mines = num_mines;
+  state->mines_left = mines_left;
+  state->timer = timer;
+  state->timer_running = timer_running;
+  state->game_running = game_running;
+  state->is_first_open = is_first_open;
+  state->game_over = game_over;
+  state->game_won = game_won;
+  state->board_revision = board_revision;
+  state->opened_cells = opened_cells;
+  state->no_guess = no_guess;
+  state->first_click_policy = first_click_policy;
+  state->cell_changes = cell_changes;
+  state->board_seeded = board_seeded;
+  state->board_id = board_id;
+  state->counters = counters;
+  memcpy(state->rng_state, rng_state, sizeof(rng_state));
+}
+
+void restoreEngineState(const EngineState *state) {
+  board_width = state->board_width;
+  board_height = state->board_height;
+  num_mines = state->num_mines;
+  mines_left = state->mines_left;
+  timer = state->timer;
+  timer_running = state->timer_running;
+  game_running = state->game_running;
+  is_first_open = state->is_first_open;
+  game_over = state->game_over;
+  game_won = state->game_won;
+  board_revision = state->board_revision;
+  opened_cells = state->opened_cells;
+  no_guess = state->no_guess;
+  first_click_policy = state->first_click_policy;
+  cell_changes = state->cell_changes;
+  board_seeded = state->board_seeded;
+  board_id = state->board_id;
+  counters = state->counters;
+  memcpy(rng_state, state->rng_state, sizeof(rng_state));
+}
+
+void seedRandom(uint64_t seed) {
+  for (int i = 0; i < 4; ++i) {
+    uint64_t z = (seed += 0x9E3779B97F4A7C15u);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+    rng_state[i] = z ^ (z >> 31);
+  }
+}
+
+uint64_t nextRandom(void) {
+  const uint64_t result = rotl(rng_state[1] * 5, 7) * 9;
+  const uint64_t t = rng_state[1] << 17;
+  rng_state[2] ^= rng_state[0];
+  rng_state[3] ^= rng_state[1];
+  rng_state[1] ^= rng_state[2];
+  rng_state[0] ^= rng_state[3];
+  rng_state[2] ^= t;
+  rng_state[3] = rotl(rng_state[3], 45);
+  return result;
+}
+
+// [0, n)
+int randint(int n) {
+  const uint64_t limit = UINT64_MAX - (UINT64_MAX % (uint64_t)n);
+
+  uint64_t r;
+  while ((r = nextRandom()) >= limit)
+    ;
+
+  return (int)(r % (uint64_t)n);
+}
+
+static inline void addChange(CellChanges *changes, int cell, uint8_t old_state, uint8_t new_state) {
+  if (!changes) {
+    return;
+  }
+  if (changes->count < changes->capacity) {
+    changes->changes[changes->count++] = (CellChange){cell, old_state, new_state};
+  } else {
+    ++changes->dropped;
+  }
+}
+
+// false: mistake
+// true: safe
+bool openCell(uint8_t *board, int x, int y) {
+  if (getDisplayState(BOARD(x, y)) != cell_display_state_closed) {
+    return true;
+  }
+  TRACE_BEGIN(openCell);
+  CellChanges *const changes = cell_changes;
+  if (getNumber(BOARD(x, y)) == 9) {
+    BOARD(x, y) = setDisplayState(BOARD(x, y), cell_display_state_mistake);
+    addChange(changes, y * board_width + x, cell_display_state_closed, cell_display_state_mistake);
+    ++board_revision;
+    TRACE_END(openCell);
+    return false;
+  }
+
+  BOARD(x, y) = setDisplayState(BOARD(x, y), cell_display_state_open);
+  addChange(changes, y * board_width + x, cell_display_state_closed, cell_display_state_open);
+  ++opened_cells;
+  ++board_revision;
+  ++counters.opens;
+  if (getNumber(BOARD(x, y)) != 0) {
+    TRACE_END(openCell);
+    return true;
+  }
+
+  // Flood fill with an explicit stack, recursing per cell overflows the call stack on large boards. Cells are opened when
+  // pushed so each one is pushed at most once. Small floods fit in the local buffer, larger ones use the thread's scratch.
+  int32_t local_stack[256];
+  const int local_capacity = sizeof(local_stack) / sizeof(local_stack[0]);
+  int32_t *stack = flood_capacity > local_capacity ? flood_stack : local_stack;
+  int stack_capacity = flood_capacity > local_capacity ? flood_capacity : local_capacity;
+  int stack_size = 0;
+  stack[stack_size++] = y * board_width + x;
+  // Counted in locals and added once at the end so the counters stay out of the inner loop's memory traffic
+  uint64_t visits = 0;
+  uint64_t opens = 1;
+  int max_stack_depth = 1;
+  while (stack_size > 0) {
+    const int cell = stack[--stack_size];
+    const int cell_x = cell % board_width;
+    const int cell_y = cell / board_width;
+    for (int ny = cell_y - 1; ny <= cell_y + 1; ++ny) {
+      for (int nx = cell_x - 1; nx <= cell_x + 1; ++nx) {
+        if (nx < 0 || nx >= board_width || ny < 0 || ny >= board_height) {
+          continue;
+        }
+        ++visits;
+        // A zero cell has no mine neighbors, so every closed one opens
+        if (getDisplayState(BOARD(nx, ny)) != cell_display_state_closed || getNumber(BOARD(nx, ny)) == 9) {
+          continue;
+        }
+        BOARD(nx, ny) = setDisplayState(BOARD(nx, ny), cell_display_state_open);
+        addChange(changes, ny * board_width + nx, cell_display_state_closed, cell_display_state_open);
+        ++opened_cells;
+        ++board_revision;
+        ++opens;
+        if (getNumber(BOARD(nx, ny)) != 0) {
+          continue;
+        }
+        if (stack_size == stack_capacity) {
+          // Only floods deeper than the reserve get here, on boards over FLOOD_RESERVE cells or on threads that didn't
+          // reserve. The stack is kept for later floods, so this is exempt from the hot path checks.
+          const bool hot = memSetHotPath(false);
+          flood_stack = growScratch(flood_stack, &flood_capacity, stack_capacity * 2, sizeof(int32_t));
+          memSetHotPath(hot);
+          if (stack == local_stack) {
+            memcpy(flood_stack, local_stack, sizeof(local_stack));
+          }
+          stack = flood_stack;
+          stack_capacity = flood_capacity;
+        }
+        stack[stack_size++] = ny * board_width + nx;
+        if (stack_size > max_stack_depth) {
+          max_stack_depth = stack_size;
+        }
+      }
+    }
+  }
+  ++counters.floods;
+  counters.flood_visits += visits;
+  counters.flood_opens += opens;
+  if (max_stack_depth > counters.max_stack_depth) {
+    counters.max_stack_depth = max_stack_depth;
+  }
+  TRACE_END(openCell);
+  return true;
+}
+
+// false: mistake
+// true: safe
+bool openNeighbors(uint8_t *board, int x, int y) {
+  TRACE_BEGIN(openNeighbors);
+  bool result = true;
+
+  const bool left_edge = x == 0;
+  const bool right_edge = x == (board_width - 1);
+  const bool top_edge = y == 0;
+  const bool bottom_edge = y == (board_height - 1);
+  // clang-format off
+  const uint8_t neighbors_flagged = (!left_edge && !top_edge && getDisplayState(BOARD(x - 1, y - 1)) == cell_display_state_flagged) +
+                                    (!left_edge && getDisplayState(BOARD(x - 1, y)) == cell_display_state_flagged) +
+                                    (!left_edge && !bottom_edge && getDisplayState(BOARD(x - 1, y + 1)) == cell_display_state_flagged) +
+
+                                    (!right_edge && !top_edge && getDisplayState(BOARD(x + 1, y - 1)) == cell_display_state_flagged) +
+                                    (!right_edge && getDisplayState(BOARD(x + 1, y)) == cell_display_state_flagged) +
+                                    (!right_edge && !bottom_edge && getDisplayState(BOARD(x + 1, y + 1)) == cell_display_state_flagged) +
+
+                                    (!top_edge && getDisplayState(BOARD(x, y - 1)) == cell_display_state_flagged) +
+                                    (!bottom_edge && getDisplayState(BOARD(x, y + 1)) == cell_display_state_flagged);
+  // clang-format on
+  ++counters.chord_attempts;
+  if (neighbors_flagged == getNumber(BOARD(x, y))) {
+    ++counters.chord_successes;
+    if (!left_edge) {
+      if (!openCell(board, x - 1, y)) {
+        result = false;
+      }
+      if (!top_edge) {
+        if (!openCell(board, x - 1, y - 1)) {
+          result = false;
+        }
+      }
+      if (!bottom_edge) {
+        if (!openCell(board, x - 1, y + 1)) {
+          result = false;
+        }
+      }
+    }
+    if (!right_edge) {
+      if (!openCell(board, x + 1, y)) {
+        result = false;
+      }
+      if (!top_edge) {
+        if (!openCell(board, x + 1, y - 1)) {
+          result = false;
+        }
+      }
+      if (!bottom_edge) {
+        if (!openCell(board, x + 1, y + 1)) {
+          result = false;
+        }
+      }
+    }
+    if (!top_edge) {
+      if (!openCell(board, x, y - 1)) {
+        result = false;
+      }
+    }
+    if (!bottom_edge) {
+      if (!openCell(board, x, y + 1)) {
+        result = false;
+      }
+    }
+  }
+
+  TRACE_END(openNeighbors);
+  return result;
+}
+
+void toggleFlagged(uint8_t *board, int x, int y) {
+  const uint8_t old_state = getDisplayState(BOARD(x, y));
+  if (old_state != cell_display_state_flagged) {
+    BOARD(x, y) = setDisplayState(BOARD(x, y), cell_display_state_flagged);
+    --mines_left;
+  } else {
+    BOARD(x, y) = setDisplayState(BOARD(x, y), cell_display_state_closed);
+    ++mines_left;
+  }
+  addChange(cell_changes, y * board_width + x, old_state, getDisplayState(BOARD(x, y)));
+  ++board_revision;
+}
+
+// Fills in the number of every cell that isn't a mine (number 9), display states are kept. Row by row from the mine counts
+// of each column over the row and its neighbors, no edge checks or branches per cell so the loops vectorize.
+void computeNumbers(uint8_t *board) {
+  const int width = board_width;
+  const int height = board_height;
+  // Padded with a zero column on both sides
+  column_scratch = growScratch(column_scratch, &column_capacity, width + 2, sizeof(uint8_t));
+  uint8_t *column_mines = column_scratch;
+  column_mines[0] = 0;
+  column_mines[width + 1] = 0;
+  for (int y = 0; y < height; ++y) {
+    uint8_t *row = board + y * width;
+    for (int x = 0; x < width; ++x) {
+      column_mines[x + 1] = getNumber(row[x]) == 9;
+    }
+    // Rows above already have their numbers, those are never 9
+    if (y > 0) {
+      for (int x = 0; x < width; ++x) {
+        column_mines[x + 1] += getNumber(row[x - width]) == 9;
+      }
+    }
+    if (y + 1 < height) {
+      for (int x = 0; x < width; ++x) {
+        column_mines[x + 1] += getNumber(row[x + width]) == 9;
+      }
+    }
+    for (int x = 0; x < width; ++x) {
+      const uint8_t neighbors = column_mines[x] + column_mines[x + 1] + column_mines[x + 2];
+      row[x] = getNumber(row[x]) == 9 ? row[x] : setDisplayState(neighbors, getDisplayState(row[x]));
+    }
+  }
+}
+
+void generateMines(uint8_t *board, int start_x, int start_y) {
+  TRACE_BEGIN(generateMines);
+  ++counters.generations;
+  const int start_safe = first_click_policy != FIRST_CLICK_ANY;
+  // Display states are kept like the neighbors', a flag on the start cell stays counted in mines_left
+  if (start_safe) {
+    BOARD(start_x, start_y) = setDisplayState(10, getDisplayState(BOARD(start_x, start_y)));
+  }
+
+  int available_start_neighbors = first_click_policy == FIRST_CLICK_OPENING ? (board_width * board_height - 1) - num_mines : 0;
+  const bool start_left_edge = start_x == 0;
+  const bool start_right_edge = start_x == (board_width - 1);
+  const bool start_top_edge = start_y == 0;
+  const bool start_bottom_edge = start_y == (board_height - 1);
+  int start_neighbors = 0;
+  // Go row by row
+  if (!start_top_edge) {
+    if (!start_left_edge) {
+      if (available_start_neighbors-- > 0) {
+        BOARD(start_x - 1, start_y - 1) = setDisplayState(10, getDisplayState(BOARD(start_x - 1, start_y - 1)));
+        ++start_neighbors;
+      }
+    }
+    if (available_start_neighbors-- > 0) {
+      BOARD(start_x, start_y - 1) = setDisplayState(10, getDisplayState(BOARD(start_x, start_y - 1)));
+      ++start_neighbors;
+    }
+    if (!start_right_edge) {
+      if (available_start_neighbors-- > 0) {
+        BOARD(start_x + 1, start_y - 1) = setDisplayState(10, getDisplayState(BOARD(start_x + 1, start_y - 1)));
+        ++start_neighbors;
+      }
+    }
+  }
+  if (!start_left_edge) {
+    if (available_start_neighbors-- > 0) {
+      BOARD(start_x - 1, start_y) = setDisplayState(10, getDisplayState(BOARD(start_x - 1, start_y)));
+      ++start_neighbors;
+    }
+  }
+  if (!start_right_edge) {
+    if (available_start_neighbors-- > 0) {
+      BOARD(start_x + 1, start_y) = setDisplayState(10, getDisplayState(BOARD(start_x + 1, start_y)));
+      ++start_neighbors;
+    }
+  }
+  if (!start_bottom_edge) {
+    if (!start_left_edge) {
+      if (available_start_neighbors-- > 0) {
+        BOARD(start_x - 1, start_y + 1) = setDisplayState(10, getDisplayState(BOARD(start_x - 1, start_y + 1)));
+        ++start_neighbors;
+      }
+    }
+    if (available_start_neighbors-- > 0) {
+      BOARD(start_x, start_y + 1) = setDisplayState(10, getDisplayState(BOARD(start_x, start_y + 1)));
+      ++start_neighbors;
+    }
+    if (!start_right_edge) {
+      if (available_start_neighbors-- > 0) {
+        BOARD(start_x + 1, start_y + 1) = setDisplayState(10, getDisplayState(BOARD(start_x + 1, start_y + 1)));
+        ++start_neighbors;
+      }
+    }
+  }
+
+  // Each mine goes on the num-th still empty cell in row order. A Fenwick tree over blocks of empty cells finds its block in
+  // O(log n) and a scan of the block finds the cell, picking exactly the same cells as a scan of the whole board. Counting
+  // per block instead of per cell keeps the tree at 4 bytes per 64 cells, so giant boards don't need a gigabyte for it.
+  const int cells = board_width * board_height;
+  const int blocks = (cells + MINE_BLOCK_SIZE - 1) / MINE_BLOCK_SIZE;
+  tree_scratch = growScratch(tree_scratch, &tree_capacity, blocks + 1, sizeof(int32_t));
+  int32_t *tree = tree_scratch;
+  memset(tree, 0, sizeof(int32_t) * (blocks + 1));
+  for (int i = 0; i < cells; ++i) {
+    tree[i / MINE_BLOCK_SIZE + 1] += getNumber(board[i]) == 0;
+  }
+  for (int i = 1; i <= blocks; ++i) {
+    const int parent = i + (i & -i);
+    if (parent <= blocks) {
+      tree[parent] += tree[i];
+    }
+  }
+  int top_step = 1;
+  while (top_step * 2 <= blocks) {
+    top_step *= 2;
+  }
+
+  int available_cells = board_width * board_height - (start_safe + start_neighbors);
+  for (int i = 0; i < num_mines; ++i) {
+    int rank = randint(available_cells) + 1;
+    int block = 0;
+    for (int step = top_step; step > 0; step >>= 1) {
+      if (block + step <= blocks && tree[block + step] < rank) {
+        block += step;
+        rank -= tree[block];
+      }
+    }
+    int position = block * MINE_BLOCK_SIZE;
+    while ((rank -= getNumber(board[position]) == 0) > 0) {
+      ++position;
+    }
+    board[position] = setDisplayState(9, getDisplayState(board[position]));
+    for (int j = block + 1; j <= blocks; j += j & -j) {
+      --tree[j];
+    }
+    --available_cells;
+  }
+  computeNumbers(board);
+  ++board_revision;
+  TRACE_END(generateMines);
+}
+
+void generateSeededMines(uint8_t *board, const BoardId *id) {
+  uint64_t saved_state[4];
+  memcpy(saved_state, rng_state, sizeof(rng_state));
+  const FirstClickPolicy saved_policy = first_click_policy;
+  seedRandom(id->seed);
+  first_click_policy = id->policy;
+  generateMines(board, id->first_click % board_width, id->first_click / board_width);
+  first_click_policy = saved_policy;
+  memcpy(rng_state, saved_state, sizeof(rng_state));
+  board_id = *id;
+  board_seeded = true;
+}
+
+void revealMines(uint8_t *board) {
+  TRACE_BEGIN(revealMines);
+  CellChanges *const changes = cell_changes;
+  for (int y = 0; y < board_height; ++y) {
+    for (int x = 0; x < board_width; ++x) {
+      const uint8_t display_state = getDisplayState(BOARD(x, y));
+      const uint8_t number = getNumber(BOARD(x, y));
+      if (number == 9 && display_state != cell_display_state_mistake && display_state != cell_display_state_flagged &&
+          display_state != cell_display_state_mine) {
+        BOARD(x, y) = setDisplayState(number, cell_display_state_mine);
+        addChange(changes, y * board_width + x, display_state, cell_display_state_mine);
+      }
+      if (display_state == cell_display_state_flagged && number != 9) {
+        BOARD(x, y) = setDisplayState(number, cell_display_state_flag_mistake);
+        addChange(changes, y * board_width + x, display_state, cell_display_state_flag_mistake);
+      }
+    }
+  }
+  ++board_revision;
+  TRACE_END(revealMines);
+}
+
+void revealFlags(uint8_t *board) {
+  for (int y = 0; y < board_height; ++y) {
+    for (int x = 0; x < board_width; ++x) {
+      if (getNumber(BOARD(x, y)) == 9 && getDisplayState(BOARD(x, y)) != cell_display_state_flagged) {
+        toggleFlagged(board, x, y);
+      }
+    }
+  }
+}
+
+// Every safe cell is open, counted by openCell so a move doesn't rescan the board
+bool checkWin(uint8_t *board) {
+  TRACE_BEGIN(checkWin);
+  const bool won = opened_cells == board_width * board_height - num_mines;
+  TRACE_END(checkWin);
+  return won;
+}
+
+void resetGame(uint8_t *board) {
+  memset(board, 0, sizeof(uint8_t) * board_width * board_height);
+  mines_left = num_mines;
+  game_running = true;
+  game_over = false;
+  is_first_open = true;
+  timer_running = false;
+  timer = 0;
+  opened_cells = 0;
+  board_seeded = false;
+  ++board_revision;
+}
+
+static void endMove(uint8_t *board, bool open_result) {
+  if (!open_result) {
+    // GAME OVER
+    timer_running = false;
+    game_running = false;
+    game_won = false;
+    game_over = true;
+    revealMines(board);
+  } else if (checkWin(board)) {
+    timer_running = false;
+    game_running = false;
+    game_won = true;
+    game_over = true;
+    revealFlags(board);
+  }
+}
+
+// The first open starts the recording. It is recorded once its layout is generated but before it opens anything, so the
+// header sees the flags placed before it and not the ones a winning first click adds.
+static void recordMove(const uint8_t *board, ReplayEventKind kind, int x, int y) {
+  if (!replay_recorder) {
+    return;
+  }
+  if (replay_recorder->started) {
+    replayWriterEvent(replay_recorder, kind, y * board_width + x);
+  } else if (kind == REPLAY_OPEN) {
+    replayWriterBegin(replay_recorder, board, board_width, board_height, no_guess ? REPLAY_FLAG_NO_GUESS : 0, y * board_width + x,
+                      board_seeded ? &board_id : NULL);
+  }
+}
+
+// Left click release on a cell, mines are placed on the first one. Each layout gets its own seed from the thread's random
+// generator, so it can be regenerated from its identity alone. A no-guess first open blocks for up to NO_GUESS_TIME_LIMIT
+// when the layout doesn't come from the pregeneration pool.
+void playOpen(uint8_t *board, int x, int y) {
+  if (is_first_open) {
+    board_seeded = false;
+    if (!no_guess || !generateNoGuessMines(board, x, y, 0, NO_GUESS_TIME_LIMIT, NULL)) {
+      const BoardId id = {GENERATOR_VERSION, nextRandom(), board_width, board_height, num_mines, y * board_width + x, first_click_policy};
+      generateSeededMines(board, &id);
+    }
+    is_first_open = false;
+  }
+  // Layouts taken from the pregeneration pool arrive with is_first_open already cleared, the recording tells the first open
+  const bool begins_recording = replay_recorder && !replay_recorder->started;
+  if (begins_recording) {
+    recordMove(board, REPLAY_OPEN, x, y);
+  }
+  endMove(board, openCell(board, x, y));
+  if (!begins_recording) {
+    recordMove(board, REPLAY_OPEN, x, y);
+  }
+}
+
+// Middle click release (or space) on an open cell
+void playChord(uint8_t *board, int x, int y) {
+  endMove(board, openNeighbors(board, x, y));
+  recordMove(board, REPLAY_CHORD, x, y);
+}
+
+// Right click (or space) on a closed or flagged cell
+void playFlag(uint8_t *board, int x, int y) {
+  toggleFlagged(board, x, y);
+  recordMove(board, REPLAY_FLAG, x, y);
+}
+
+EngineCounters getEngineCounters(void) { return counters; }
+
+void resetEngineCounters(void) { counters = (EngineCounters){0}; }
+
+void addGenerationRetries(uint64_t retries) { counters.generation_retries += retries; }
@@ -0,0 +1,168 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "threadlocal.h"
+
+#define BOARD(x, y) (board[(y) * board_width + (x)])
+
+// beginner, intermediate, expert
+// board_width, board_height, num_mines
+extern int difficulty_nums[9];
+
+// Engine state is per thread so worker threads (no-guess generation, simulation) can each run their own game
+
+extern thread_local int board_width;
+extern thread_local int board_height;
+extern thread_local int num_mines;
+extern thread_local int mines_left;
+
+extern thread_local uint32_t timer;
+extern thread_local bool timer_running;
+extern thread_local bool game_running;
+extern thread_local bool is_first_open;
+extern thread_local bool game_over;
+extern thread_local bool game_won;
+
+// Bumped every time the engine changes the board, so consumers (e.g. the hint solver) can tell when their view is stale
+extern thread_local uint32_t board_revision;
+// Safe cells opened so far this game
+extern thread_local int opened_cells;
+// First open generates a layout that can be cleared without guessing
+extern thread_local bool no_guess;
+
+// What generateMines keeps free of mines around the first open
+typedef enum FirstClickPolicy {
+  FIRST_CLICK_OPENING, // the cell and its neighbors, so the first click always opens an area
+  FIRST_CLICK_SAFE,    // only the cell itself
+  FIRST_CLICK_ANY      // nothing, the first click can hit a mine
+} FirstClickPolicy;
+extern thread_local FirstClickPolicy first_click_policy;
+
+// Bumped whenever a change to generateMines or the random generator makes a seed produce a different layout
+#define GENERATOR_VERSION 1
+
+// Canonical identity of a layout: generateSeededMines makes the same mines from the same identity on any machine, so
+// replays and share codes can store this instead of the mine cells
+typedef struct BoardId {
+  uint32_t generator_version;
+  uint64_t seed;
+  int32_t width;
+  int32_t height;
+  int32_t mines;
+  int32_t first_click; // y * width + x
+  FirstClickPolicy policy;
+} BoardId;
+
+// Identity of the current game's layout, board_seeded is false until the first open placed the mines and stays false when
+// they didn't come from a seed (no-guess layouts depend on how much work fits in a time budget, loaded games)
+extern thread_local bool board_seeded;
+extern thread_local BoardId board_id;
+
+// Work done by the engine on the calling thread, so the cost of each operation can be compared between algorithms
+typedef struct EngineCounters {
+  uint64_t opens;              // openCell calls that opened a safe cell
+  uint64_t floods;             // of those, ones that hit a zero cell and flood filled
+  uint64_t flood_visits;       // neighbor cells examined by flood fills
+  uint64_t flood_opens;        // cells opened by flood fills, including the zero cell they started from
+  int max_stack_depth;         // deepest the flood fill stack got
+  uint64_t chord_attempts;     // openNeighbors calls
+  uint64_t chord_successes;    // of those, ones with the flag count matching the number, so the neighbors were opened
+  uint64_t generations;        // generateMines calls
+  uint64_t generation_retries; // no-guess candidate layouts thrown away because they needed a guess
+} EngineCounters;
+
+// A display state change made by the engine. Numbers only change when mines are generated.
+typedef struct CellChange {
+  int32_t cell; // y * board_width + x
+  uint8_t old_state;
+  uint8_t new_state;
+} CellChange;
+
+// Buffer supplied by the caller, filled while cell_changes points at it: openCell, openNeighbors, toggleFlagged,
+// revealMines and revealFlags (and the play functions through them) append every cell they change, in order, so a
+// consumer can follow the board without rescanning it. Reset count between operations to get the changes of each one.
+// Changes that don't fit are counted in dropped, the consumer has to rescan the board then. generateMines, resetGame and
+// loading a game rewrite the whole board without adding changes, board_revision tells when that happened.
+typedef struct CellChanges {
+  CellChange *changes;
+  int capacity;
+  int count;
+  int dropped;
+} CellChanges;
+
+extern thread_local CellChanges *cell_changes;
+
+// Everything the engine keeps per thread except its scratch, so a thread can play throwaway games (e.g. no-guess
+// candidates when no worker thread could be started) and then carry on with its own as if nothing happened
+typedef struct EngineState {
+  int board_width;
+  int board_height;
+  int num_mines;
+  int mines_left;
+  uint32_t timer;
+  bool timer_running;
+  bool game_running;
+  bool is_first_open;
+  bool game_over;
+  bool game_won;
+  uint32_t board_revision;
+  int opened_cells;
+  bool no_guess;
+  FirstClickPolicy first_click_policy;
+  CellChanges *cell_changes;
+  bool board_seeded;
+  BoardId board_id;
+  EngineCounters counters;
+  uint64_t rng_state[4];
+} EngineState;
+
+static const uint8_t number_mask = 0x0F; // 0b00001111
+
+static const uint8_t cell_display_state_closed = 0;
+static const uint8_t cell_display_state_open = 1;
+static const uint8_t cell_display_state_flagged = 2;
+static const uint8_t cell_display_state_mine = 3;
+static const uint8_t cell_display_state_mistake = 4;
+static const uint8_t cell_display_state_flag_mistake = 5;
+static const uint8_t cell_display_state_press = 6;
+static inline uint8_t getDisplayState(uint8_t cell) { return cell >> 4; }
+
+static inline uint8_t setDisplayState(uint8_t cell, uint8_t state) { return (cell & number_mask) | (state << 4); }
+
+static inline uint8_t getNumber(uint8_t cell) { return cell & number_mask; }
+
+void saveEngineState(EngineState *state);
+void restoreEngineState(const EngineState *state);
+
+void seedRandom(uint64_t seed);
+uint64_t nextRandom(void);
+int randint(int n);
+
+bool openCell(uint8_t *board, int x, int y);
+bool openNeighbors(uint8_t *board, int x, int y);
+void toggleFlagged(uint8_t *board, int x, int y);
+// Flood fills, computeNumbers and generateMines keep their scratch per thread and grow it on first use. Reserving it for
+// the board size up front keeps the first click and large floods on that thread from allocating.
+void reserveEngineScratch(int width, int height);
+// Threads that used the engine free their scratch before they exit
+void freeEngineScratch(void);
+void computeNumbers(uint8_t *board);
+void generateMines(uint8_t *board, int start_x, int start_y);
+// board_width, board_height and num_mines have to match the identity already. The thread's random generator is left as it was.
+void generateSeededMines(uint8_t *board, const BoardId *id);
+void revealMines(uint8_t *board);
+void revealFlags(uint8_t *board);
+bool checkWin(uint8_t *board);
+void resetGame(uint8_t *board);
+void playOpen(uint8_t *board, int x, int y);
+void playChord(uint8_t *board, int x, int y);
+void playFlag(uint8_t *board, int x, int y);
+
+EngineCounters getEngineCounters(void);
+void resetEngineCounters(void);
+void addGenerationRetries(uint64_t retries);
+
+#endif
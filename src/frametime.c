@@ -0,0 +1,76 @@
+#include "frametime.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "timing.h"
+
+const char *frame_phase_names[FRAME_PHASE_COUNT] = {"input", "engine", "board", "ui", "present"};
+
+void frameTimerEnable(FrameTimer *timer, bool enabled) {
+  timer->enabled = enabled;
+  timer->frame_start = 0;
+  timer->head = 0;
+  timer->count = 0;
+}
+
+void frameTimerBegin(FrameTimer *timer) {
+  if (!timer->enabled) {
+    return;
+  }
+  timer->frame_start = getNanoseconds();
+  timer->phase_start = timer->frame_start;
+  memset(timer->current, 0, sizeof(timer->current));
+}
+
+void frameTimerPhase(FrameTimer *timer, FramePhase phase) {
+  if (!timer->enabled) {
+    return;
+  }
+  const uint64_t now = getNanoseconds();
+  timer->current[phase] += (now - timer->phase_start) * 1e-6f;
+  timer->phase_start = now;
+}
+
+void frameTimerEnd(FrameTimer *timer) {
+  // A frame that started before the timer was enabled has no start time
+  if (!timer->enabled || timer->frame_start == 0) {
+    return;
+  }
+  timer->frame_ms[timer->head] = (getNanoseconds() - timer->frame_start) * 1e-6f;
+  for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+    timer->phase_ms[phase][timer->head] = timer->current[phase];
+  }
+  timer->head = (timer->head + 1) % FRAME_SAMPLES;
+  if (timer->count < FRAME_SAMPLES) {
+    ++timer->count;
+  }
+}
+
+static int compareFloats(const void *a, const void *b) {
+  const float x = *(const float *)a;
+  const float y = *(const float *)b;
+  return (x > y) - (x < y);
+}
+
+void frameTimerStats(const FrameTimer *timer, FrameStats *stats) {
+  *stats = (FrameStats){0};
+  if (timer->count == 0) {
+    return;
+  }
+  // The ring is full or filled from index 0, either way the first count entries are the samples
+  float sorted[FRAME_SAMPLES];
+  memcpy(sorted, timer->frame_ms, sizeof(float) * timer->count);
+  qsort(sorted, timer->count, sizeof(float), compareFloats);
+  stats->p50 = sorted[(timer->count - 1) * 50 / 100];
+  stats->p95 = sorted[(timer->count - 1) * 95 / 100];
+  stats->p99 = sorted[(timer->count - 1) * 99 / 100];
+  stats->max = sorted[timer->count - 1];
+  for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+    float sum = 0.0f;
+    for (int i = 0; i < timer->count; ++i) {
+      sum += timer->phase_ms[phase][i];
+    }
+    stats->phase_mean[phase] = sum / timer->count;
+  }
+}
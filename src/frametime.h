@@ -0,0 +1,51 @@
+#ifndef FRAMETIME_H
+#define FRAMETIME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Rolling frame time statistics, split into the phases of the main loop
+#define FRAME_SAMPLES 240
+
+typedef enum FramePhase {
+  FRAME_PHASE_INPUT,   // mouse and keyboard handling, including the moves they trigger
+  FRAME_PHASE_ENGINE,  // hint solver, bot and other per frame updates
+  FRAME_PHASE_BOARD,   // drawing the board into the render target
+  FRAME_PHASE_UI,      // counters, face button and raygui
+  FRAME_PHASE_PRESENT, // drawing the render target to the window and swapping buffers
+  FRAME_PHASE_COUNT
+} FramePhase;
+
+typedef struct FrameTimer {
+  bool enabled;
+  uint64_t frame_start;
+  uint64_t phase_start;
+  float current[FRAME_PHASE_COUNT];
+  // Ring buffers in milliseconds
+  float frame_ms[FRAME_SAMPLES];
+  float phase_ms[FRAME_PHASE_COUNT][FRAME_SAMPLES];
+  int head;
+  int count;
+} FrameTimer;
+
+typedef struct FrameStats {
+  float p50;
+  float p95;
+  float p99;
+  float max;
+  float phase_mean[FRAME_PHASE_COUNT];
+} FrameStats;
+
+extern const char *frame_phase_names[FRAME_PHASE_COUNT];
+
+// Enabling starts over with an empty history
+void frameTimerEnable(FrameTimer *timer, bool enabled);
+// These return immediately while the timer is disabled
+void frameTimerBegin(FrameTimer *timer);
+// Ends phase, the next one starts now
+void frameTimerPhase(FrameTimer *timer, FramePhase phase);
+void frameTimerEnd(FrameTimer *timer);
+
+void frameTimerStats(const FrameTimer *timer, FrameStats *stats);
+
+#endif
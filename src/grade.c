@@ -0,0 +1,137 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "engine.h"
+#include "metrics.h"
+#include "platform.h"
+#include "timing.h"
+
+typedef struct GradeWorker {
+  int width;
+  int height;
+  int mines;
+  uint64_t boards;
+  uint64_t seed;
+  // Results, merged after join
+  uint64_t *bbbv_histogram; // width * height + 1 buckets
+  uint64_t openings;
+  uint64_t isolated_numbers;
+  uint64_t largest_opening;
+} GradeWorker;
+
+static int gradeWorker(void *arg) {
+  GradeWorker *worker = arg;
+  board_width = worker->width;
+  board_height = worker->height;
+  num_mines = worker->mines;
+  seedRandom(worker->seed);
+
+  const int cells = worker->width * worker->height;
+  uint8_t *board = malloc(sizeof(uint8_t) * cells);
+  int32_t *scratch = malloc(sizeof(int32_t) * cells);
+  for (uint64_t i = 0; i < worker->boards; ++i) {
+    resetGame(board);
+    generateMines(board, randint(worker->width), randint(worker->height));
+    BoardMetrics metrics;
+    computeBoardMetrics(board, worker->width, worker->height, scratch, &metrics);
+    ++worker->bbbv_histogram[metrics.bbbv];
+    worker->openings += metrics.openings;
+    worker->isolated_numbers += metrics.isolated_numbers;
+    worker->largest_opening += metrics.largest_opening;
+  }
+  free(scratch);
+  free(board);
+  freeEngineScratch();
+  return 0;
+}
+
+static int histogramPercentile(const uint64_t *histogram, int buckets, uint64_t total, double percentile) {
+  const uint64_t target = (uint64_t)(percentile * (total - 1));
+  uint64_t seen = 0;
+  for (int i = 0; i < buckets; ++i) {
+    seen += histogram[i];
+    if (seen > target) {
+      return i;
+    }
+  }
+  return buckets - 1;
+}
+
+// minesweeper-grade [boards] [threads] [width height mines]
+// Generates random layouts (first click anywhere) and reports the 3BV distribution and grading throughput
+int main(int argc, char **argv) {
+  const long long boards = argc > 1 ? atoll(argv[1]) : 1000000;
+  const int threads = argc > 2 ? atoi(argv[2]) : getCoreCount();
+  const int width = argc > 5 ? atoi(argv[3]) : difficulty_nums[6];
+  const int height = argc > 5 ? atoi(argv[4]) : difficulty_nums[7];
+  const int mines = argc > 5 ? atoi(argv[5]) : difficulty_nums[8];
+  if (boards < 1 || threads < 1 || width < 1 || height < 1 || mines < 1 || mines > width * height - 1) {
+    fprintf(stderr, "usage: minesweeper-grade [boards] [threads] [width height mines]\n");
+    return 1;
+  }
+
+  const int buckets = width * height + 1;
+  seedRandom((uint64_t)time(NULL));
+  GradeWorker *workers = calloc(threads, sizeof(GradeWorker));
+  thrd_t *handles = malloc(sizeof(thrd_t) * threads);
+  bool *started = malloc(sizeof(bool) * threads);
+  const uint64_t start = getNanoseconds();
+  for (int i = 0; i < threads; ++i) {
+    workers[i] = (GradeWorker){width, height, mines, boards / threads + (i < boards % threads), nextRandom(), NULL, 0, 0, 0};
+    workers[i].bbbv_histogram = calloc(buckets, sizeof(uint64_t));
+    started[i] = thrd_create(&handles[i], gradeWorker, &workers[i]) == thrd_success;
+  }
+  // A worker that couldn't be started grades its share on this thread, with the thread's own engine state put back after
+  for (int i = 0; i < threads; ++i) {
+    if (!started[i]) {
+      EngineState state;
+      saveEngineState(&state);
+      gradeWorker(&workers[i]);
+      restoreEngineState(&state);
+    }
+  }
+  for (int i = 0; i < threads; ++i) {
+    if (started[i]) {
+      thrd_join(handles[i], NULL);
+    }
+  }
+  const double seconds = (getNanoseconds() - start) * 1e-9;
+
+  uint64_t *histogram = calloc(buckets, sizeof(uint64_t));
+  uint64_t openings = 0;
+  uint64_t isolated_numbers = 0;
+  uint64_t largest_opening = 0;
+  for (int i = 0; i < threads; ++i) {
+    for (int b = 0; b < buckets; ++b) {
+      histogram[b] += workers[i].bbbv_histogram[b];
+    }
+    openings += workers[i].openings;
+    isolated_numbers += workers[i].isolated_numbers;
+    largest_opening += workers[i].largest_opening;
+    free(workers[i].bbbv_histogram);
+  }
+  double bbbv_sum = 0.0;
+  for (int b = 0; b < buckets; ++b) {
+    bbbv_sum += (double)b * histogram[b];
+  }
+
+  printf("%dx%d, %d mines, %lld boards on %d threads\n", width, height, mines, boards, threads);
+  printf("time:             %.3f s (%.0f boards/s, %.1f M boards/min)\n", seconds, boards / seconds, boards / seconds * 60.0 * 1e-6);
+  printf("3BV:              mean %.2f, min %d, p10 %d, p50 %d, p90 %d, max %d\n", bbbv_sum / boards,
+         histogramPercentile(histogram, buckets, boards, 0.0), histogramPercentile(histogram, buckets, boards, 0.1),
+         histogramPercentile(histogram, buckets, boards, 0.5), histogramPercentile(histogram, buckets, boards, 0.9),
+         histogramPercentile(histogram, buckets, boards, 1.0));
+  printf("openings:         mean %.2f\n", (double)openings / boards);
+  printf("isolated numbers: mean %.2f\n", (double)isolated_numbers / boards);
+  printf("largest opening:  mean %.2f cells\n", (double)largest_opening / boards);
+
+  free(histogram);
+  free(started);
+  free(handles);
+  free(workers);
+  return 0;
+}
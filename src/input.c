@@ -0,0 +1,260 @@
+#include "input.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// File layout, native byte order:
+//   header: "MSIN", uint32 version, uint64 seed
+//   frame:  double time, float mouse x, mouse y, wheel, uint8 buttons down, pressed, released (bit per mouse button),
+//           uint16 keys down, uint16 keys pressed, uint8 chars, then that many uint16 keys, uint16 keys and int32 chars
+static const char input_magic[4] = {'M', 'S', 'I', 'N'};
+static const uint32_t input_version = 1;
+
+#define INPUT_MOUSE_BUTTONS 7 // MOUSE_BUTTON_LEFT .. MOUSE_BUTTON_BACK
+#define INPUT_KEY_BYTES ((INPUT_KEY_COUNT + 7) / 8)
+
+typedef struct InputFrame {
+  double time;
+  Vector2 mouse;
+  float wheel;
+  uint8_t buttons_down;
+  uint8_t buttons_pressed;
+  uint8_t buttons_released;
+  uint8_t keys_down[INPUT_KEY_BYTES];
+  uint8_t keys_pressed[INPUT_KEY_BYTES];
+  int32_t chars[INPUT_MAX_CHARS];
+  int char_count;
+  int char_next; // chars already handed out by inputCharPressed this frame
+} InputFrame;
+
+static InputMode mode = INPUT_LIVE;
+static InputFrame frame = {0};
+static FILE *record_file = NULL;
+static uint8_t *replay_data = NULL;
+static size_t replay_size = 0;
+static size_t replay_offset = 0;
+
+static bool testBit(const uint8_t *bits, int i) { return bits[i >> 3] & (1u << (i & 7)); }
+
+static void setBit(uint8_t *bits, int i) { bits[i >> 3] |= (uint8_t)(1u << (i & 7)); }
+
+bool inputStartRecording(const char *path, uint64_t seed) {
+  record_file = fopen(path, "wb");
+  if (!record_file) {
+    fprintf(stderr, "input: cannot write %s\n", path);
+    return false;
+  }
+  fwrite(input_magic, 1, sizeof(input_magic), record_file);
+  fwrite(&input_version, sizeof(input_version), 1, record_file);
+  fwrite(&seed, sizeof(seed), 1, record_file);
+  mode = INPUT_RECORD;
+  return true;
+}
+
+bool inputStartReplay(const char *path, uint64_t *seed) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "input: cannot read %s\n", path);
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  replay_data = malloc(size > 0 ? size : 1);
+  replay_size = size > 0 && fread(replay_data, 1, size, file) == (size_t)size ? (size_t)size : 0;
+  fclose(file);
+
+  uint32_t version = 0;
+  const size_t header_size = sizeof(input_magic) + sizeof(version) + sizeof(*seed);
+  if (replay_size >= header_size) {
+    memcpy(&version, replay_data + sizeof(input_magic), sizeof(version));
+  }
+  if (replay_size < header_size || memcmp(replay_data, input_magic, sizeof(input_magic)) != 0 || version != input_version) {
+    fprintf(stderr, "input: %s is not an input recording\n", path);
+    free(replay_data);
+    replay_data = NULL;
+    return false;
+  }
+  memcpy(seed, replay_data + sizeof(input_magic) + sizeof(version), sizeof(*seed));
+  replay_offset = header_size;
+  mode = INPUT_REPLAY;
+  return true;
+}
+
+void inputStop(void) {
+  if (record_file) {
+    fclose(record_file);
+    record_file = NULL;
+  }
+  free(replay_data);
+  replay_data = NULL;
+  replay_size = 0;
+  mode = INPUT_LIVE;
+}
+
+InputMode inputMode(void) { return mode; }
+
+static void sampleFrame(void) {
+  frame = (InputFrame){0};
+  frame.time = GetTime();
+  frame.mouse = GetMousePosition();
+  frame.wheel = GetMouseWheelMove();
+  for (int button = 0; button < INPUT_MOUSE_BUTTONS; ++button) {
+    frame.buttons_down |= IsMouseButtonDown(button) << button;
+    frame.buttons_pressed |= IsMouseButtonPressed(button) << button;
+    frame.buttons_released |= IsMouseButtonReleased(button) << button;
+  }
+  for (int key = 1; key < INPUT_KEY_COUNT; ++key) {
+    if (IsKeyDown(key)) {
+      setBit(frame.keys_down, key);
+    }
+    if (IsKeyPressed(key)) {
+      setBit(frame.keys_pressed, key);
+    }
+  }
+  int c;
+  while ((c = GetCharPressed()) != 0) {
+    if (frame.char_count < INPUT_MAX_CHARS) {
+      frame.chars[frame.char_count++] = c;
+    }
+  }
+}
+
+static void writeKeys(const uint8_t *bits) {
+  uint16_t count = 0;
+  for (int key = 1; key < INPUT_KEY_COUNT; ++key) {
+    count += testBit(bits, key);
+  }
+  fwrite(&count, sizeof(count), 1, record_file);
+  for (uint16_t key = 1; key < INPUT_KEY_COUNT; ++key) {
+    if (testBit(bits, key)) {
+      fwrite(&key, sizeof(key), 1, record_file);
+    }
+  }
+}
+
+static void writeFrame(void) {
+  fwrite(&frame.time, sizeof(frame.time), 1, record_file);
+  fwrite(&frame.mouse.x, sizeof(float), 1, record_file);
+  fwrite(&frame.mouse.y, sizeof(float), 1, record_file);
+  fwrite(&frame.wheel, sizeof(float), 1, record_file);
+  fwrite(&frame.buttons_down, 1, 1, record_file);
+  fwrite(&frame.buttons_pressed, 1, 1, record_file);
+  fwrite(&frame.buttons_released, 1, 1, record_file);
+  writeKeys(frame.keys_down);
+  writeKeys(frame.keys_pressed);
+  const uint8_t char_count = (uint8_t)frame.char_count;
+  fwrite(&char_count, 1, 1, record_file);
+  fwrite(frame.chars, sizeof(int32_t), char_count, record_file);
+}
+
+static bool readBytes(void *out, size_t size) {
+  if (replay_size - replay_offset < size) {
+    return false;
+  }
+  memcpy(out, replay_data + replay_offset, size);
+  replay_offset += size;
+  return true;
+}
+
+static bool readKeys(uint8_t *bits) {
+  uint16_t count;
+  if (!readBytes(&count, sizeof(count))) {
+    return false;
+  }
+  for (int i = 0; i < count; ++i) {
+    uint16_t key;
+    if (!readBytes(&key, sizeof(key))) {
+      return false;
+    }
+    if (key < INPUT_KEY_COUNT) {
+      setBit(bits, key);
+    }
+  }
+  return true;
+}
+
+static bool readFrame(void) {
+  frame = (InputFrame){0};
+  uint8_t char_count;
+  if (!readBytes(&frame.time, sizeof(frame.time)) || !readBytes(&frame.mouse.x, sizeof(float)) ||
+      !readBytes(&frame.mouse.y, sizeof(float)) || !readBytes(&frame.wheel, sizeof(float)) || !readBytes(&frame.buttons_down, 1) ||
+      !readBytes(&frame.buttons_pressed, 1) || !readBytes(&frame.buttons_released, 1) || !readKeys(frame.keys_down) ||
+      !readKeys(frame.keys_pressed) || !readBytes(&char_count, 1)) {
+    return false;
+  }
+  for (int i = 0; i < char_count; ++i) {
+    int32_t c;
+    if (!readBytes(&c, sizeof(c))) {
+      return false;
+    }
+    if (frame.char_count < INPUT_MAX_CHARS) {
+      frame.chars[frame.char_count++] = c;
+    }
+  }
+  return true;
+}
+
+bool inputBeginFrame(void) {
+  if (mode == INPUT_RECORD) {
+    sampleFrame();
+    writeFrame();
+  } else if (mode == INPUT_REPLAY) {
+    if (!readFrame()) {
+      if (replay_offset != replay_size) {
+        fprintf(stderr, "input: recording is truncated\n");
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+double inputTime(void) { return mode == INPUT_LIVE ? GetTime() : frame.time; }
+
+Vector2 inputMousePosition(void) { return mode == INPUT_LIVE ? GetMousePosition() : frame.mouse; }
+
+float inputMouseWheelMove(void) { return mode == INPUT_LIVE ? GetMouseWheelMove() : frame.wheel; }
+
+bool inputMouseButtonDown(int button) {
+  if (mode == INPUT_LIVE) {
+    return IsMouseButtonDown(button);
+  }
+  return button >= 0 && button < INPUT_MOUSE_BUTTONS && (frame.buttons_down >> button) & 1;
+}
+
+bool inputMouseButtonPressed(int button) {
+  if (mode == INPUT_LIVE) {
+    return IsMouseButtonPressed(button);
+  }
+  return button >= 0 && button < INPUT_MOUSE_BUTTONS && (frame.buttons_pressed >> button) & 1;
+}
+
+bool inputMouseButtonReleased(int button) {
+  if (mode == INPUT_LIVE) {
+    return IsMouseButtonReleased(button);
+  }
+  return button >= 0 && button < INPUT_MOUSE_BUTTONS && (frame.buttons_released >> button) & 1;
+}
+
+bool inputKeyDown(int key) {
+  if (mode == INPUT_LIVE) {
+    return IsKeyDown(key);
+  }
+  return key > 0 && key < INPUT_KEY_COUNT && testBit(frame.keys_down, key);
+}
+
+bool inputKeyPressed(int key) {
+  if (mode == INPUT_LIVE) {
+    return IsKeyPressed(key);
+  }
+  return key > 0 && key < INPUT_KEY_COUNT && testBit(frame.keys_pressed, key);
+}
+
+int inputCharPressed(void) {
+  if (mode == INPUT_LIVE) {
+    return GetCharPressed();
+  }
+  return frame.char_next < frame.char_count ? frame.chars[frame.char_next++] : 0;
+}
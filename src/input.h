@@ -0,0 +1,47 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <raylib.h>
+
+// Input as the main loop sees it. Live, it passes straight through to raylib. Recording, the state is sampled once per
+// frame, served from that sample and appended to a file. Replaying, the samples come back out of the file instead, so a
+// session can be played again without anyone at the keyboard (e.g. under Xvfb) to compare frame times between builds.
+//
+// main.c redirects raylib's input calls (raygui's included) to the functions below, GetTime included so the game timer
+// follows the recorded clock.
+
+typedef enum InputMode {
+  INPUT_LIVE,
+  INPUT_RECORD,
+  INPUT_REPLAY
+} InputMode;
+
+// Keys above this are not recorded, raylib's last key is KEY_KB_MENU (348)
+#define INPUT_KEY_COUNT 349
+// Characters typed in one frame beyond this are dropped
+#define INPUT_MAX_CHARS 16
+
+// seed is stored in the file so the replay draws the same layouts
+bool inputStartRecording(const char *path, uint64_t seed);
+// Loads the whole recording, seed receives the recorded one
+bool inputStartReplay(const char *path, uint64_t *seed);
+void inputStop(void);
+InputMode inputMode(void);
+
+// Call once at the top of each frame. Returns false once a replay has run out of frames.
+bool inputBeginFrame(void);
+
+double inputTime(void);
+Vector2 inputMousePosition(void);
+float inputMouseWheelMove(void);
+bool inputMouseButtonDown(int button);
+bool inputMouseButtonPressed(int button);
+bool inputMouseButtonReleased(int button);
+bool inputKeyDown(int key);
+bool inputKeyPressed(int key);
+int inputCharPressed(void);
+
+#endif
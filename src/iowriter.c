@@ -0,0 +1,304 @@
+#include "iowriter.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "memtrack.h"
+#include "platform.h"
+#include "timing.h"
+#include "trace.h"
+
+typedef struct IoRequest {
+  IoWriteMode mode;
+  IoSync sync;
+  int64_t offset;
+  const uint8_t *data;
+  size_t size;
+  size_t ring_bytes; // taken from the ring, including the end skipped when it wrapped around
+  bool owned;        // data has its own allocation
+  char path[IO_PATH_MAX];
+} IoRequest;
+
+// Requests and ring bytes are counted up forever, the submitting thread only moves the heads and the worker the tails
+typedef struct IoQueue {
+  bool running;
+  thrd_t thread;
+  mtx_t lock; // only for sleeping and waking, never held during a write
+  cnd_t wake;
+  cnd_t idle;
+  atomic_bool sleeping;
+  atomic_bool stopping;
+
+  IoRequest requests[IO_QUEUE_SLOTS];
+  atomic_uint_fast64_t request_head;
+  atomic_uint_fast64_t request_tail;
+  uint8_t *ring;
+  uint64_t ring_head;
+  atomic_uint_fast64_t ring_tail;
+
+  uint64_t submitted; // submitting thread
+  uint64_t completed; // worker
+  uint64_t synced;    // under the lock, requests done including their batched fsyncs
+
+  // Files written with IO_SYNC_BATCH since the queue was last empty
+  char pending_syncs[IO_QUEUE_SLOTS][IO_PATH_MAX];
+  int num_pending_syncs;
+
+  // Read once the worker has stopped
+  uint64_t writes;
+  uint64_t bytes;
+  uint64_t fsyncs;
+  uint64_t failures;
+  uint64_t slowest_ns;
+  uint64_t overflows;
+  uint64_t stalls;
+  int max_depth;
+} IoQueue;
+
+static IoQueue queue = {0};
+
+static bool syncPath(const char *path) {
+  FILE *file = fopen(path, "r+b");
+  const bool synced = file && syncFile(file);
+  if (file) {
+    fclose(file);
+  }
+  ++queue.fsyncs;
+  return synced;
+}
+
+static void syncPending(void) {
+  for (int i = 0; i < queue.num_pending_syncs; ++i) {
+    if (!syncPath(queue.pending_syncs[i])) {
+      fprintf(stderr, "io: cannot sync %s\n", queue.pending_syncs[i]);
+    }
+  }
+  queue.num_pending_syncs = 0;
+}
+
+static void addPendingSync(const char *path) {
+  for (int i = 0; i < queue.num_pending_syncs; ++i) {
+    if (strcmp(queue.pending_syncs[i], path) == 0) {
+      return;
+    }
+  }
+  if (queue.num_pending_syncs == IO_QUEUE_SLOTS) {
+    syncPending();
+  }
+  strcpy(queue.pending_syncs[queue.num_pending_syncs++], path);
+}
+
+static bool writeData(FILE *file, const IoRequest *request, bool sync) {
+  bool written = request->size == 0 || fwrite(request->data, 1, request->size, file) == request->size;
+  if (written && sync) {
+    written = syncFile(file);
+    ++queue.fsyncs;
+  }
+  return fclose(file) == 0 && written;
+}
+
+// Batched syncs are left to the caller, who knows when the queue ran empty
+static bool performRequest(const IoRequest *request, bool batching) {
+  TRACE_BEGIN(ioWrite);
+  const uint64_t start = getNanoseconds();
+  const bool sync_now = request->sync == IO_SYNC_EACH || (request->sync == IO_SYNC_BATCH && !batching);
+  bool done = false;
+  FILE *file = NULL;
+  switch (request->mode) {
+  case IO_CREATE:
+    file = fopen(request->path, "wb");
+    done = file && writeData(file, request, sync_now);
+    break;
+  case IO_REPLACE: {
+    // The new contents have to be on disk before the rename, or a crash could leave an empty file in place of the old one
+    char temporary[IO_PATH_MAX + 4];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", request->path);
+    file = fopen(temporary, "wb");
+    done = file && writeData(file, request, request->sync != IO_SYNC_NONE) && replaceFile(temporary, request->path);
+    if (!done) {
+      remove(temporary);
+    }
+    break;
+  }
+  case IO_AT:
+    file = fopen(request->path, "r+b");
+    file = file ? file : fopen(request->path, "wb");
+    if (file && !seekFile(file, request->offset)) {
+      fclose(file);
+      file = NULL;
+    }
+    done = file && writeData(file, request, sync_now);
+    break;
+  case IO_REMOVE:
+    // Nothing to do if it is already gone
+    remove(request->path);
+    done = true;
+    break;
+  }
+  if (done && request->sync == IO_SYNC_BATCH && !sync_now && request->mode != IO_REMOVE) {
+    addPendingSync(request->path);
+  }
+  if (!done) {
+    fprintf(stderr, "io: cannot write %s\n", request->path);
+    ++queue.failures;
+  }
+  const uint64_t elapsed = getNanoseconds() - start;
+  queue.slowest_ns = elapsed > queue.slowest_ns ? elapsed : queue.slowest_ns;
+  ++queue.writes;
+  queue.bytes += request->size;
+  TRACE_END(ioWrite);
+  return done;
+}
+
+static int ioWorker(void *arg) {
+  TRACE_THREAD_NAME("io");
+  for (;;) {
+    const uint64_t tail = atomic_load_explicit(&queue.request_tail, memory_order_relaxed);
+    if (tail == atomic_load(&queue.request_head)) {
+      syncPending();
+      mtx_lock(&queue.lock);
+      queue.synced = queue.completed;
+      cnd_broadcast(&queue.idle);
+      // Checked again after announcing the sleep, a request submitted in between either shows up here or gets a wake up
+      atomic_store(&queue.sleeping, true);
+      const bool empty = tail == atomic_load(&queue.request_head);
+      if (empty && atomic_load(&queue.stopping)) {
+        mtx_unlock(&queue.lock);
+        break;
+      }
+      if (empty) {
+        cnd_wait(&queue.wake, &queue.lock);
+      }
+      atomic_store(&queue.sleeping, false);
+      mtx_unlock(&queue.lock);
+      continue;
+    }
+    const IoRequest *request = &queue.requests[tail % IO_QUEUE_SLOTS];
+    performRequest(request, true);
+    if (request->owned) {
+      memFree((void *)request->data);
+    }
+    const uint64_t ring_tail = atomic_load_explicit(&queue.ring_tail, memory_order_relaxed);
+    atomic_store_explicit(&queue.ring_tail, ring_tail + request->ring_bytes, memory_order_release);
+    atomic_store_explicit(&queue.request_tail, tail + 1, memory_order_release);
+    ++queue.completed;
+  }
+  return 0;
+}
+
+void ioStart(void) {
+  mtx_init(&queue.lock, mtx_plain);
+  cnd_init(&queue.wake);
+  cnd_init(&queue.idle);
+  queue.ring = memAlloc(MEM_IO, IO_RING_BYTES);
+  queue.running = thrd_create(&queue.thread, ioWorker, NULL) == thrd_success;
+}
+
+void ioStop(void) {
+  if (!queue.ring) {
+    return;
+  }
+  if (queue.running) {
+    mtx_lock(&queue.lock);
+    atomic_store(&queue.stopping, true);
+    cnd_signal(&queue.wake);
+    mtx_unlock(&queue.lock);
+    thrd_join(queue.thread, NULL);
+    queue.running = false;
+  }
+  cnd_destroy(&queue.idle);
+  cnd_destroy(&queue.wake);
+  mtx_destroy(&queue.lock);
+  memFree(queue.ring);
+  queue.ring = NULL;
+}
+
+void ioFlush(void) {
+  if (!queue.running) {
+    return;
+  }
+  mtx_lock(&queue.lock);
+  while (queue.synced < queue.submitted) {
+    cnd_wait(&queue.idle, &queue.lock);
+  }
+  mtx_unlock(&queue.lock);
+}
+
+// Into the ring when there is room, wrapping around to its start rather than splitting the data
+static const uint8_t *copyData(const void *data, size_t size, IoRequest *request) {
+  request->ring_bytes = 0;
+  request->owned = false;
+  if (size == 0) {
+    return NULL;
+  }
+  const uint64_t position = queue.ring_head % IO_RING_BYTES;
+  const size_t skipped = position + size > IO_RING_BYTES ? IO_RING_BYTES - position : 0;
+  const uint64_t used = queue.ring_head - atomic_load_explicit(&queue.ring_tail, memory_order_acquire);
+  if (skipped + size <= IO_RING_BYTES - used) {
+    uint8_t *copy = queue.ring + (skipped ? 0 : position);
+    memcpy(copy, data, size);
+    queue.ring_head += skipped + size;
+    request->ring_bytes = skipped + size;
+    return copy;
+  }
+  // Writes that don't fit the ring are rare and counted, exempt from the hot path checks
+  ++queue.overflows;
+  const bool hot = memSetHotPath(false);
+  uint8_t *copy = memAlloc(MEM_IO, size);
+  memSetHotPath(hot);
+  memcpy(copy, data, size);
+  request->owned = true;
+  return copy;
+}
+
+bool ioWrite(const char *path, IoWriteMode mode, IoSync sync, int64_t offset, const void *data, size_t size) {
+  if (strlen(path) >= IO_PATH_MAX) {
+    fprintf(stderr, "io: path too long: %s\n", path);
+    return false;
+  }
+  if (!queue.running) {
+    IoRequest request = {mode, sync, offset, data, size, 0, false, {0}};
+    strcpy(request.path, path);
+    return performRequest(&request, false);
+  }
+  // Only waits when the worker is a whole queue behind
+  const uint64_t head = atomic_load_explicit(&queue.request_head, memory_order_relaxed);
+  if (head - atomic_load_explicit(&queue.request_tail, memory_order_acquire) == IO_QUEUE_SLOTS) {
+    ++queue.stalls;
+    while (head - atomic_load_explicit(&queue.request_tail, memory_order_acquire) == IO_QUEUE_SLOTS) {
+      thrd_yield();
+    }
+  }
+  IoRequest *request = &queue.requests[head % IO_QUEUE_SLOTS];
+  request->mode = mode;
+  request->sync = sync;
+  request->offset = offset;
+  request->size = size;
+  strcpy(request->path, path);
+  request->data = copyData(data, size, request);
+  atomic_store(&queue.request_head, head + 1);
+  ++queue.submitted;
+  const int depth = (int)(head + 1 - atomic_load_explicit(&queue.request_tail, memory_order_relaxed));
+  queue.max_depth = depth > queue.max_depth ? depth : queue.max_depth;
+  if (atomic_load(&queue.sleeping)) {
+    mtx_lock(&queue.lock);
+    cnd_signal(&queue.wake);
+    mtx_unlock(&queue.lock);
+  }
+  return true;
+}
+
+bool ioRemove(const char *path) { return ioWrite(path, IO_REMOVE, IO_SYNC_NONE, 0, NULL, 0); }
+
+void ioPrintStats(void) {
+  if (queue.writes == 0) {
+    return;
+  }
+  printf("io: %llu writes (%llu failed), %.1f KiB, %llu fsyncs, slowest %.2f ms, max queue depth %d, %llu overflowed the ring, "
+         "%llu stalls\n",
+         (unsigned long long)queue.writes, (unsigned long long)queue.failures, queue.bytes / 1024.0, (unsigned long long)queue.fsyncs,
+         queue.slowest_ns * 1e-6, queue.max_depth, (unsigned long long)queue.overflows, (unsigned long long)queue.stalls);
+}
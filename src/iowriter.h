@@ -0,0 +1,42 @@
+#ifndef IOWRITER_H
+#define IOWRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Background thread for the files the game writes (replays, saves, statistics), so a slow disk never stalls a frame.
+// Writes are copied into a preallocated ring and queued without locks, the calling thread only waits when the worker is
+// asleep and has to be woken. Only one thread may submit at a time. Without ioStart every call writes straight away.
+
+typedef enum IoWriteMode {
+  IO_CREATE,  // the file is created or truncated
+  IO_REPLACE, // written to path.tmp and renamed over the file, so it has either the old or the new contents
+  IO_AT,      // written at the offset, the file is created if it doesn't exist
+  IO_REMOVE   // the file is removed, there is no data
+} IoWriteMode;
+
+typedef enum IoSync {
+  IO_SYNC_NONE,  // left to the OS
+  IO_SYNC_BATCH, // flushed to disk once the queue runs empty, a burst of writes to one file costs one fsync
+  IO_SYNC_EACH   // flushed to disk straight after the write
+} IoSync;
+
+// Queued writes
+#define IO_QUEUE_SLOTS 64
+// Data of queued writes, anything that doesn't fit gets its own allocation
+#define IO_RING_BYTES (1024 * 1024)
+#define IO_PATH_MAX 512
+
+void ioStart(void);
+// Writes everything still queued and stops the thread
+void ioStop(void);
+// Waits until everything queued was written (and synced as asked), before reading back a file that was just written
+void ioFlush(void);
+// false if the path is too long, or without the thread if the write failed. The worker reports its failures on stderr.
+bool ioWrite(const char *path, IoWriteMode mode, IoSync sync, int64_t offset, const void *data, size_t size);
+bool ioRemove(const char *path);
+// Writes, bytes, fsyncs and how long the slowest write took, for the summary on exit
+void ioPrintStats(void);
+
+#endif
@@ -0,0 +1,187 @@
+#include "layout.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+#include "memtrack.h"
+
+// Open cells given as digits keep the digit in their display state until the numbers are known
+#define OPEN_DIGIT_STATE 7
+
+// Cell for each character plus one, 0 for characters that aren't cells
+#define LAYOUT_CELL(number, state) ((uint8_t)(((state) << 4 | (number)) + 1))
+static const uint8_t layout_cells[256] = {
+    ['.'] = LAYOUT_CELL(0, 0),
+    ['*'] = LAYOUT_CELL(9, 0),
+    ['F'] = LAYOUT_CELL(9, 2),
+    ['f'] = LAYOUT_CELL(0, 2),
+    ['0'] = LAYOUT_CELL(0, OPEN_DIGIT_STATE + 0),
+    ['1'] = LAYOUT_CELL(0, OPEN_DIGIT_STATE + 1),
+    ['2'] = LAYOUT_CELL(0, OPEN_DIGIT_STATE + 2),
+    ['3'] = LAYOUT_CELL(0, OPEN_DIGIT_STATE + 3),
+    ['4'] = LAYOUT_CELL(0, OPEN_DIGIT_STATE + 4),
+    ['5'] = LAYOUT_CELL(0, OPEN_DIGIT_STATE + 5),
+    ['6'] = LAYOUT_CELL(0, OPEN_DIGIT_STATE + 6),
+    ['7'] = LAYOUT_CELL(0, OPEN_DIGIT_STATE + 7),
+    ['8'] = LAYOUT_CELL(0, OPEN_DIGIT_STATE + 8),
+};
+
+// Numbers the board and fills in the game, the first open digit that doesn't match its mines is returned, -1 if none
+static int finishLayout(uint8_t *board, int width, int height, SavedGame *game) {
+  const int saved_width = board_width;
+  const int saved_height = board_height;
+  board_width = width;
+  board_height = height;
+  computeNumbers(board);
+  board_width = saved_width;
+  board_height = saved_height;
+
+  const int cells = width * height;
+  int mismatch = -1;
+  int mines = 0;
+  int flags = 0;
+  int opened = 0;
+  for (int i = 0; i < cells; ++i) {
+    const uint8_t number = getNumber(board[i]);
+    const uint8_t state = getDisplayState(board[i]);
+    if (state >= OPEN_DIGIT_STATE) {
+      mismatch = mismatch < 0 && number != state - OPEN_DIGIT_STATE ? i : mismatch;
+      board[i] = setDisplayState(board[i], cell_display_state_open);
+    }
+    mines += number == 9;
+    flags += state == cell_display_state_flagged;
+    opened += state == cell_display_state_open || state >= OPEN_DIGIT_STATE;
+  }
+  const bool won = opened == cells - mines;
+  *game = (SavedGame){width, height, mines, mines - flags, 0, won ? SAVE_GAME_OVER | SAVE_GAME_WON : 0, board};
+  return mismatch;
+}
+
+bool layoutOpen(LayoutReader *reader, const char *path) {
+  *reader = (LayoutReader){0};
+  reader->path = path;
+  reader->line = 1;
+  if (!openFileView(path, &reader->view, &reader->file_buffer, &reader->file_buffer_capacity)) {
+    fprintf(stderr, "layout: cannot read %s\n", path);
+    free(reader->file_buffer);
+    reader->file_buffer = NULL;
+    return false;
+  }
+  return true;
+}
+
+static bool layoutError(LayoutReader *reader, int line, int column, const char *message) {
+  fprintf(stderr, "layout: %s:%d:%d: %s\n", reader->path, line, column, message);
+  reader->failed = true;
+  return false;
+}
+
+bool layoutNext(LayoutReader *reader, SavedGame *game) {
+  *game = (SavedGame){0};
+  const uint8_t *data = reader->view.data;
+  const size_t size = reader->view.size;
+  size_t offset = reader->offset;
+  int width = 0;
+  int height = 0;
+  while (offset < size && !reader->failed) {
+    const uint8_t *end = memchr(data + offset, '\n', size - offset);
+    const size_t next = end ? (size_t)(end - data) + 1 : size;
+    size_t length = (end ? (size_t)(end - data) : size) - offset;
+    length -= length > 0 && data[offset + length - 1] == '\r';
+    const int line = reader->line++;
+    const uint8_t *text = data + offset;
+    offset = next;
+    if (length > 0 && text[0] == '#') {
+      continue;
+    }
+    if (length == 0) {
+      // Blank lines before a position are skipped, after one they end it
+      if (height > 0) {
+        break;
+      }
+      continue;
+    }
+    if (height == 0) {
+      width = length <= INT32_MAX ? (int)length : 0;
+    } else if (length != (size_t)width) {
+      return layoutError(reader, line, 1, "rows of the position differ in length");
+    }
+    if (width == 0 || height + 1 > INT32_MAX / width) {
+      return layoutError(reader, line, 1, "position is too large");
+    }
+    const size_t needed = (size_t)(height + 1) * width;
+    if (needed > reader->board_capacity) {
+      reader->board_capacity = needed > 2 * reader->board_capacity ? needed : 2 * reader->board_capacity;
+      reader->board = memRealloc(MEM_BOARD, reader->board, reader->board_capacity);
+    }
+    if (height == reader->row_capacity) {
+      reader->row_capacity = reader->row_capacity > 0 ? 2 * reader->row_capacity : 64;
+      reader->row_lines = memRealloc(MEM_BOARD, reader->row_lines, sizeof(int) * reader->row_capacity);
+    }
+    reader->row_lines[height] = line;
+    uint8_t *row = reader->board + (size_t)height * width;
+    uint8_t invalid = 0;
+    for (int x = 0; x < width; ++x) {
+      const uint8_t code = layout_cells[text[x]];
+      row[x] = code - 1;
+      invalid |= code == 0;
+    }
+    if (invalid) {
+      int x = 0;
+      while (layout_cells[text[x]] != 0) {
+        ++x;
+      }
+      return layoutError(reader, line, x + 1, "not a cell, expected one of . * F f 0-8");
+    }
+    ++height;
+  }
+  reader->offset = offset;
+  if (height == 0 || reader->failed) {
+    return false;
+  }
+  const int mismatch = finishLayout(reader->board, width, height, game);
+  if (mismatch >= 0) {
+    *game = (SavedGame){0};
+    return layoutError(reader, reader->row_lines[mismatch / width], mismatch % width + 1, "number doesn't match the mines around it");
+  }
+  return true;
+}
+
+void layoutClose(LayoutReader *reader) {
+  closeFileView(&reader->view);
+  free(reader->file_buffer);
+  memFree(reader->board);
+  memFree(reader->row_lines);
+  *reader = (LayoutReader){0};
+}
+
+bool layoutFromPixels(const uint8_t *pixels, int width, int height, SavedGame *game) {
+  *game = (SavedGame){0};
+  if (width <= 0 || height <= 0 || width > INT32_MAX / height) {
+    fprintf(stderr, "layout: a %dx%d image can't be a board\n", width, height);
+    return false;
+  }
+  const int cells = width * height;
+  uint8_t *board = memAlloc(MEM_BOARD, cells);
+  for (int i = 0; i < cells; ++i) {
+    const uint8_t *pixel = pixels + 4 * (size_t)i;
+    const int r = pixel[0], g = pixel[1], b = pixel[2];
+    const bool opaque = pixel[3] >= 128;
+    const bool dark = r + g + b < 3 * 64;
+    const bool red = r >= 128 && g < 128 && b < 128;
+    const bool green = g >= 128 && r < 128 && b < 128;
+    uint8_t cell = 0;
+    if (opaque && dark) {
+      cell = 9;
+    } else if (opaque && red) {
+      cell = setDisplayState(9, cell_display_state_flagged);
+    } else if (opaque && green) {
+      cell = setDisplayState(0, cell_display_state_open);
+    }
+    board[i] = cell;
+  }
+  finishLayout(board, width, height, game);
+  return true;
+}
@@ -0,0 +1,44 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform.h"
+#include "savegame.h"
+
+// Exact positions for bug reports and benchmark corpora, as text with one character per cell and one line per row:
+//
+//   .  closed          *  closed mine
+//   F  flagged mine    f  flag on a safe cell
+//   0-8  open, checked against the mines around it
+//
+// A file can hold any number of positions separated by blank lines, lines starting with '#' are comments. The file is
+// parsed in place (mapped when it is large), numbers are rebuilt with computeNumbers like after generateMines.
+
+typedef struct LayoutReader {
+  const char *path;
+  FileView view;
+  uint8_t *file_buffer; // small files are read into this instead of being mapped
+  size_t file_buffer_capacity;
+  size_t offset;
+  int line;
+  bool failed;
+  uint8_t *board;
+  size_t board_capacity;
+  int *row_lines; // source line of each row, comments can sit between them
+  int row_capacity;
+} LayoutReader;
+
+bool layoutOpen(LayoutReader *reader, const char *path);
+// The next position as a game in progress, its board belongs to the reader and is overwritten by the next call.
+// false at the end of the file, or with reader->failed set on a malformed position (reported on stderr with its line).
+bool layoutNext(LayoutReader *reader, SavedGame *game);
+void layoutClose(LayoutReader *reader);
+
+// A mask image with one RGBA pixel per cell: dark is a mine, red a flagged mine, green an open cell, anything else a closed
+// safe cell. game->board is allocated, free it with savedGameFree.
+bool layoutFromPixels(const uint8_t *pixels, int width, int height, SavedGame *game);
+
+#endif
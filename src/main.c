@@ -1,27 +1,50 @@
 #include <assert.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 #include <time.h>
 
 #include <raylib.h>
 #include <raymath.h>
 
-#define RAYGUI_IMPLEMENTATION
-#include "raygui.h"
+#include "input.h"
 
-#define BOARD(x, y) (board[(y) * board_width + (x)])
+// Everything below, raygui included, reads input through input.c so sessions can be recorded and replayed
+#define GetTime inputTime
+#define GetMousePosition inputMousePosition
+#define GetMouseWheelMove inputMouseWheelMove
+#define IsMouseButtonDown inputMouseButtonDown
+#define IsMouseButtonPressed inputMouseButtonPressed
+#define IsMouseButtonReleased inputMouseButtonReleased
+#define IsKeyDown inputKeyDown
+#define IsKeyPressed inputKeyPressed
+#define GetCharPressed inputCharPressed
 
-int board_width = 9;
-int board_height = 9;
-int num_mines = 10;
-int mines_left = 10;
+#define RAYGUI_IMPLEMENTATION
+#include "raygui.h"
 
-// beginner, intermediate, expert
-// board_width, board_height, num_mines
-int difficulty_nums[] = {9, 9, 10, 16, 16, 40, 30, 16, 99};
+#include "bot.h"
+#include "engine.h"
+#include "frametime.h"
+#include "iowriter.h"
+#include "layout.h"
+#include "memtrack.h"
+#include "metrics.h"
+#include "platform.h"
+#include "pregen.h"
+#include "replay.h"
+#include "savegame.h"
+#include "solver.h"
+#include "stats.h"
+#include "timing.h"
+#include "trace.h"
+#include "view.h"
+
+// beginner, intermediate, expert, see difficulty_nums
 char *difficulty_strs[] = {"9", "9", "10", "16", "16", "40", "30", "16", "99"};
 
 int render_width;
@@ -71,375 +94,577 @@ typedef enum CellRects {
   ATLAS_FACE_WIN
 } CellRects;
 
-uint32_t timer = 0;
-bool timer_running = false;
 double timer_start = 0.0;
-bool game_running = true;
-bool is_first_open = true;
-bool game_over = false;
-bool game_won = false;
 
-const uint8_t number_mask = 0x0F; // 0b00001111
-
-const uint8_t cell_display_state_closed = 0;
-const uint8_t cell_display_state_open = 1;
-const uint8_t cell_display_state_flagged = 2;
-const uint8_t cell_display_state_mine = 3;
-const uint8_t cell_display_state_mistake = 4;
-const uint8_t cell_display_state_flag_mistake = 5;
-const uint8_t cell_display_state_press = 6;
-static inline uint8_t getDisplayState(uint8_t cell) { return cell >> 4; }
-
-static inline uint8_t setDisplayState(uint8_t cell, uint8_t state) { return (cell & number_mask) | (state << 4); }
+// First click latency (generation + opening), printed on exit
+#define FIRST_CLICK_SAMPLES 1024
+double first_click_latencies[FIRST_CLICK_SAMPLES];
+int first_click_count = 0;
+int first_click_pool_hits = 0;
+
+// Time the hint solver may use per frame, the rest of the frame is left for input and drawing
+const double hint_budget = 0.004;
+
+// Largest custom board the game dialog offers. Share codes asking for more are refused, every seeded board the game makes
+// fits in these.
+#define CUSTOM_SIZE_MAX 1000
+#define CUSTOM_MINES_MAX 1000
+
+// Textures live on the GPU, counted as 4 bytes per pixel
+static int64_t textureBytes(Texture2D texture) { return (int64_t)texture.width * texture.height * 4; }
+
+// Boards with at least this many cells live in a scratch file mapping instead of on the heap, so a 20000x20000 board (400 MB)
+// only keeps the parts being played in RAM
+#define BOARD_MAP_CELLS (16 * 1024 * 1024)
+const char *board_map_path = "minesweeper-board.tmp";
+FileMapping board_mapping = {0};
+
+// The contents are only kept while the board stays on the heap, callers reset or restore it afterwards
+uint8_t *allocateBoard(uint8_t *board, int cells) {
+  if (board && board == board_mapping.data) {
+    memAccount(MEM_BOARD, -(int64_t)board_mapping.size);
+    unmapScratchFile(&board_mapping);
+    board = NULL;
+  }
+  if (cells >= BOARD_MAP_CELLS && mapScratchFile(board_map_path, sizeof(uint8_t) * cells, &board_mapping)) {
+    memFree(board);
+    memAccount(MEM_BOARD, (int64_t)board_mapping.size);
+    return board_mapping.data;
+  }
+  return memRealloc(MEM_BOARD, board, sizeof(uint8_t) * cells);
+}
 
-static inline uint8_t getNumber(uint8_t cell) { return cell & number_mask; }
+void freeBoard(uint8_t *board) {
+  if (board && board == board_mapping.data) {
+    memAccount(MEM_BOARD, -(int64_t)board_mapping.size);
+    unmapScratchFile(&board_mapping);
+  } else {
+    memFree(board);
+  }
+}
 
-// [0, n)
-int randint(int n) {
-  const int limit = RAND_MAX - (RAND_MAX % n);
+// Grading scratch sized with the board so the frame that wins a game doesn't allocate. Mapped boards are too big to keep a
+// second copy of around, they are graded with a temporary one.
+int32_t *grade_scratch = NULL;
 
-  int r;
-  while ((r = rand()) >= limit)
-    ;
+void resizeGradeScratch(const uint8_t *board, int cells) {
+  if (board == board_mapping.data) {
+    memFree(grade_scratch);
+    grade_scratch = NULL;
+  } else {
+    grade_scratch = memRealloc(MEM_ENGINE, grade_scratch, sizeof(int32_t) * cells);
+  }
+}
 
-  return r % n;
+void resizeBoard(uint8_t **board, int new_width, int new_height, RenderTexture2D *render_target) {
+  TRACE_BEGIN(resizeBoard);
+  board_width = new_width;
+  board_height = new_height;
+  *board = allocateBoard(*board, board_width * board_height);
+  resizeGradeScratch(*board, board_width * board_height);
+  reserveEngineScratch(board_width, board_height);
+  render_width = 40 + board_width * 20;
+  render_height = 110 + board_height * 20;
+  SetWindowSize(render_width * scale, render_height * scale);
+  memAccount(MEM_RENDER, -textureBytes(render_target->texture));
+  UnloadRenderTexture(*render_target);
+  *render_target = LoadRenderTexture(render_width, render_height);
+  memAccount(MEM_RENDER, textureBytes(render_target->texture));
+  TRACE_END(resizeBoard);
 }
 
-bool findCollisionCell(Vector2 mouse_pos, Vector2 top_left, int *out_x, int *out_y) {
-  for (int x = 0; x < board_width; ++x) {
-    for (int y = 0; y < board_height; ++y) {
-      Rectangle cell_rect = {top_left.x + x * 20.0f + 2.0f, top_left.y + y * 20.0f + 2.0f, 16.0f, 16.0f};
-      if (CheckCollisionPointRec(mouse_pos, cell_rect)) {
-        *out_x = x;
-        *out_y = y;
-        return true;
-      }
-    }
+void printEngineCounters(void) {
+  const EngineCounters counters = getEngineCounters();
+  if (counters.opens == 0 && counters.chord_attempts == 0) {
+    return;
   }
-  *out_x = -1;
-  *out_y = -1;
-  return false;
+  printf("engine: %llu opens, %llu flood fills visiting %llu cells to open %llu (%.2f visits per open, max stack depth %d)\n",
+         (unsigned long long)counters.opens, (unsigned long long)counters.floods, (unsigned long long)counters.flood_visits,
+         (unsigned long long)counters.flood_opens, counters.flood_opens ? (double)counters.flood_visits / counters.flood_opens : 0.0,
+         counters.max_stack_depth);
+  printf("engine: %llu/%llu chords opened, %llu layouts generated, %llu no-guess retries\n", (unsigned long long)counters.chord_successes,
+         (unsigned long long)counters.chord_attempts, (unsigned long long)counters.generations,
+         (unsigned long long)counters.generation_retries);
 }
 
-// false: mistake
-// true: safe
-bool openCell(uint8_t *board, int x, int y) {
-  if (getDisplayState(BOARD(x, y)) != cell_display_state_closed) {
-    return true;
+// minesweeper --bot [width height mines [games]]
+// Lets the bot play without a window, as fast as it can
+int runHeadlessBot(int argc, char **argv) {
+  if (argc >= 3) {
+    board_width = atoi(argv[0]);
+    board_height = atoi(argv[1]);
+    num_mines = atoi(argv[2]);
+  } else {
+    board_width = difficulty_nums[6];
+    board_height = difficulty_nums[7];
+    num_mines = difficulty_nums[8];
   }
-  if (getNumber(BOARD(x, y)) == 9) {
-    BOARD(x, y) = setDisplayState(BOARD(x, y), cell_display_state_mistake);
-    return false;
+  const int games = argc >= 4 ? atoi(argv[3]) : 1;
+  if (board_width < 1 || board_height < 1 || board_width > INT32_MAX / board_height || num_mines < 0 || games < 1) {
+    fprintf(stderr, "usage: minesweeper --bot [width height mines [games]]\n");
+    return 1;
+  }
+  if (num_mines > board_width * board_height - 1) {
+    num_mines = board_width * board_height - 1;
   }
 
-  BOARD(x, y) = setDisplayState(BOARD(x, y), cell_display_state_open);
-  const bool left_edge = x == 0;
-  const bool right_edge = x == (board_width - 1);
-  const bool top_edge = y == 0;
-  const bool bottom_edge = y == (board_height - 1);
-  if (getNumber(BOARD(x, y)) == 0) {
-    if (!left_edge) {
-      openCell(board, x - 1, y);
-      if (!top_edge) {
-        openCell(board, x - 1, y - 1);
-      }
-      if (!bottom_edge) {
-        openCell(board, x - 1, y + 1);
-      }
-    }
-    if (!right_edge) {
-      openCell(board, x + 1, y);
-      if (!top_edge) {
-        openCell(board, x + 1, y - 1);
-      }
-      if (!bottom_edge) {
-        openCell(board, x + 1, y + 1);
-      }
-    }
-    if (!top_edge) {
-      openCell(board, x, y - 1);
-    }
-    if (!bottom_edge) {
-      openCell(board, x, y + 1);
-    }
+  seedRandom((uint64_t)time(NULL));
+
+  uint8_t *board = allocateBoard(NULL, board_width * board_height);
+  Bot bot = {0};
+  int wins = 0;
+  uint64_t moves = 0;
+  uint64_t guesses = 0;
+  const uint64_t start = getNanoseconds();
+  for (int game = 0; game < games; ++game) {
+    resetGame(board);
+    botReset(&bot);
+    while (botStep(&bot, board, 0.0) == BOT_MOVED)
+      ;
+    wins += game_won;
+    moves += bot.moves;
+    guesses += bot.guesses;
   }
-  return true;
-}
+  const double seconds = (getNanoseconds() - start) * 1e-9;
 
-// false: mistake
-// true: safe
-bool openNeighbors(uint8_t *board, int x, int y) {
-  bool result = true;
-
-  const bool left_edge = x == 0;
-  const bool right_edge = x == (board_width - 1);
-  const bool top_edge = y == 0;
-  const bool bottom_edge = y == (board_height - 1);
-  // clang-format off
-  const uint8_t neighbors_flagged = (!left_edge && !top_edge && getDisplayState(BOARD(x - 1, y - 1)) == cell_display_state_flagged) +
-                                    (!left_edge && getDisplayState(BOARD(x - 1, y)) == cell_display_state_flagged) +
-                                    (!left_edge && !bottom_edge && getDisplayState(BOARD(x - 1, y + 1)) == cell_display_state_flagged) +
-
-                                    (!right_edge && !top_edge && getDisplayState(BOARD(x + 1, y - 1)) == cell_display_state_flagged) +
-                                    (!right_edge && getDisplayState(BOARD(x + 1, y)) == cell_display_state_flagged) +
-                                    (!right_edge && !bottom_edge && getDisplayState(BOARD(x + 1, y + 1)) == cell_display_state_flagged) +
-
-                                    (!top_edge && getDisplayState(BOARD(x, y - 1)) == cell_display_state_flagged) +
-                                    (!bottom_edge && getDisplayState(BOARD(x, y + 1)) == cell_display_state_flagged);
-  // clang-format on
-  if (neighbors_flagged == getNumber(BOARD(x, y))) {
-    if (!left_edge) {
-      if (!openCell(board, x - 1, y)) {
-        result = false;
-      }
-      if (!top_edge) {
-        if (!openCell(board, x - 1, y - 1)) {
-          result = false;
-        }
-      }
-      if (!bottom_edge) {
-        if (!openCell(board, x - 1, y + 1)) {
-          result = false;
-        }
-      }
-    }
-    if (!right_edge) {
-      if (!openCell(board, x + 1, y)) {
-        result = false;
-      }
-      if (!top_edge) {
-        if (!openCell(board, x + 1, y - 1)) {
-          result = false;
-        }
-      }
-      if (!bottom_edge) {
-        if (!openCell(board, x + 1, y + 1)) {
-          result = false;
-        }
-      }
-    }
-    if (!top_edge) {
-      if (!openCell(board, x, y - 1)) {
-        result = false;
-      }
-    }
-    if (!bottom_edge) {
-      if (!openCell(board, x, y + 1)) {
-        result = false;
-      }
-    }
+  printf("board: %dx%d, %d mines\n", board_width, board_height, num_mines);
+  if (games == 1) {
+    printf("outcome: %s\n", game_won ? "won" : "lost");
+  } else {
+    printf("outcome: %d/%d won (%.2f%%)\n", wins, games, 100.0 * wins / games);
   }
+  printf("moves: %llu (%llu guesses)\n", (unsigned long long)moves, (unsigned long long)guesses);
+  printf("wall time: %.3f s\n", seconds);
+  printf("moves/s: %.0f\n", moves / seconds);
+  printEngineCounters();
+
+  botFree(&bot);
+  freeEngineScratch();
+  freeBoard(board);
+  memPrintStats();
+  return 0;
+}
 
-  return result;
+static int compareDoubles(const void *a, const void *b) {
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+  return (x > y) - (x < y);
 }
 
-void toggleFlagged(uint8_t *board, int x, int y) {
-  if (getDisplayState(BOARD(x, y)) != cell_display_state_flagged) {
-    BOARD(x, y) = setDisplayState(BOARD(x, y), cell_display_state_flagged);
-    --mines_left;
-  } else {
-    BOARD(x, y) = setDisplayState(BOARD(x, y), cell_display_state_closed);
-    ++mines_left;
+void printFirstClickLatency(void) {
+  if (first_click_count == 0) {
+    return;
   }
+  const int samples = first_click_count < FIRST_CLICK_SAMPLES ? first_click_count : FIRST_CLICK_SAMPLES;
+  qsort(first_click_latencies, samples, sizeof(double), compareDoubles);
+  printf("first click latency over %d games (%d from the pregeneration pool): p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+         first_click_count, first_click_pool_hits, first_click_latencies[samples / 2] * 1000.0,
+         first_click_latencies[samples * 9 / 10] * 1000.0, first_click_latencies[samples * 99 / 100] * 1000.0,
+         first_click_latencies[samples - 1] * 1000.0);
 }
 
-void generateMines(uint8_t *board, int start_x, int start_y) {
-  BOARD(start_x, start_y) = setDisplayState(10, cell_display_state_closed);
+// Every game is recorded and written to replays/ when it ends or is abandoned
+ReplayWriter game_replay = {0};
+int replays_saved = 0;
 
-  int available_start_neighbors = (board_width * board_height - 1) - num_mines;
-  const bool start_left_edge = start_x == 0;
-  const bool start_right_edge = start_x == (board_width - 1);
-  const bool start_top_edge = start_y == 0;
-  const bool start_bottom_edge = start_y == (board_height - 1);
-  int start_neighbors = 0;
-  // Go row by row
-  if (!start_top_edge) {
-    if (!start_left_edge) {
-      if (available_start_neighbors-- > 0) {
-        BOARD(start_x - 1, start_y - 1) = setDisplayState(10, getDisplayState(BOARD(start_x - 1, start_y - 1)));
-        ++start_neighbors;
-      }
-    }
-    if (available_start_neighbors-- > 0) {
-      BOARD(start_x, start_y - 1) = setDisplayState(10, getDisplayState(BOARD(start_x, start_y - 1)));
-      ++start_neighbors;
-    }
-    if (!start_right_edge) {
-      if (available_start_neighbors-- > 0) {
-        BOARD(start_x + 1, start_y - 1) = setDisplayState(10, getDisplayState(BOARD(start_x + 1, start_y - 1)));
-        ++start_neighbors;
-      }
-    }
+void saveReplay(void) {
+  if (!game_replay.started) {
+    return;
   }
-  if (!start_left_edge) {
-    if (available_start_neighbors-- > 0) {
-      BOARD(start_x - 1, start_y) = setDisplayState(10, getDisplayState(BOARD(start_x - 1, start_y)));
-      ++start_neighbors;
-    }
+  char path[64];
+  const time_t now = time(NULL);
+  const size_t length = strftime(path, sizeof(path), "replays/%Y%m%d-%H%M%S", localtime(&now));
+  snprintf(path + length, sizeof(path) - length, "-%d.msr", replays_saved++);
+  if (makeDirectory("replays")) {
+    replayWriterSave(&game_replay, path);
   }
-  if (!start_right_edge) {
-    if (available_start_neighbors-- > 0) {
-      BOARD(start_x + 1, start_y) = setDisplayState(10, getDisplayState(BOARD(start_x + 1, start_y)));
-      ++start_neighbors;
+  replayWriterReset(&game_replay);
+}
+
+// F5 saves the game to quicksave.mss and F9 loads it back, autosave.mss is written on exit and resumed on the next start
+const char *quicksave_path = "quicksave.mss";
+const char *autosave_path = "autosave.mss";
+
+uint32_t elapsedMs(void) { return timer_running ? (uint32_t)((GetTime() - timer_start) * 1000.0) : timer * 1000u; }
+
+// Finished games are logged to stats.msl, F2 shows the statistics of the current difficulty. stats_game_flags collects what
+// keeps the current game out of the best times, stats_logged is set once it was logged.
+const char *stats_log_path = "stats.msl";
+const char *stats_index_path = "stats.msx";
+Stats stats = {0};
+bool stats_open = false;
+uint32_t stats_game_flags = 0;
+bool stats_logged = false;
+
+// A loaded game carries on without a replay, it has no record of the moves before it
+void resumeGame(const SavedGame *game, uint8_t *board) {
+  restoreGame(game, board);
+  stats_game_flags = is_first_open ? 0 : STATS_RESUMED;
+  stats_logged = game_over;
+  timer_start = GetTime() - game->elapsed_ms / 1000.0;
+  timer_running = !is_first_open && !game_over;
+  saveReplay();
+  replay_recorder = is_first_open ? &game_replay : NULL;
+}
+
+// Positions from bug reports and test corpora, given with --import or dropped on the window: the first position of a text
+// layout, or a PNG mask (see layout.h). They carry on like a loaded game.
+bool importLayout(const char *path, SavedGame *game) {
+  if (IsFileExtension(path, ".png")) {
+    Image image = LoadImage(path);
+    if (!image.data) {
+      return false;
     }
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    const bool imported = layoutFromPixels(image.data, image.width, image.height, game);
+    UnloadImage(image);
+    return imported;
   }
-  if (!start_bottom_edge) {
-    if (!start_left_edge) {
-      if (available_start_neighbors-- > 0) {
-        BOARD(start_x - 1, start_y + 1) = setDisplayState(10, getDisplayState(BOARD(start_x - 1, start_y + 1)));
-        ++start_neighbors;
-      }
-    }
-    if (available_start_neighbors-- > 0) {
-      BOARD(start_x, start_y + 1) = setDisplayState(10, getDisplayState(BOARD(start_x, start_y + 1)));
-      ++start_neighbors;
-    }
-    if (!start_right_edge) {
-      if (available_start_neighbors-- > 0) {
-        BOARD(start_x + 1, start_y + 1) = setDisplayState(10, getDisplayState(BOARD(start_x + 1, start_y + 1)));
-        ++start_neighbors;
-      }
-    }
+  LayoutReader reader;
+  if (!layoutOpen(&reader, path)) {
+    return false;
+  }
+  const bool imported = layoutNext(&reader, game);
+  if (imported) {
+    uint8_t *copy = memAlloc(MEM_BOARD, (size_t)game->width * game->height);
+    memcpy(copy, game->board, (size_t)game->width * game->height);
+    game->board = copy;
+  } else if (!reader.failed) {
+    fprintf(stderr, "layout: %s has no position\n", path);
   }
+  layoutClose(&reader);
+  return imported;
+}
 
-  int available_cells = board_width * board_height - (1 + start_neighbors);
-  for (int i = 0; i < num_mines; ++i) {
-    int num = randint(available_cells);
-    for (int y = 0; y < board_height; ++y) {
-      for (int x = 0; x < board_width; ++x) {
-        if (getNumber(BOARD(x, y)) == 0) {
-          if (num-- == 0) {
-            BOARD(x, y) = setDisplayState(9, getDisplayState(BOARD(x, y)));
-          }
-        }
-      }
-    }
-    --available_cells;
+// Playback speeds of the replay viewer, changed with + and -
+const int viewer_speeds[] = {1, 2, 5, 10, 25, 50, 100};
+#define VIEWER_SPEED_COUNT (int)(sizeof(viewer_speeds) / sizeof(viewer_speeds[0]))
+
+// Frame times of a --replay-input run, printed when it finishes
+float *replay_frame_ms = NULL;
+int replay_frame_count = 0;
+int replay_frame_capacity = 0;
+
+static int compareFloats(const void *a, const void *b) {
+  const float x = *(const float *)a;
+  const float y = *(const float *)b;
+  return (x > y) - (x < y);
+}
+
+void printReplayFrameTimes(void) {
+  if (replay_frame_count == 0) {
+    return;
   }
-  for (int y = 0; y < board_height; ++y) {
-    for (int x = 0; x < board_width; ++x) {
-      if (getNumber(BOARD(x, y)) == 9) {
-        continue;
-      }
-      const bool left_edge = x == 0;
-      const bool right_edge = x == (board_width - 1);
-      const bool top_edge = y == 0;
-      const bool bottom_edge = y == (board_height - 1);
-      // clang-format off
-      const uint8_t neighbors = (!left_edge && !top_edge && getNumber(BOARD(x - 1, y - 1)) == 9) +
-                                (!left_edge && getNumber(BOARD(x - 1, y)) == 9) +
-                                (!left_edge && !bottom_edge && getNumber(BOARD(x - 1, y + 1)) == 9) +
-
-                                (!right_edge && !top_edge && getNumber(BOARD(x + 1, y - 1)) == 9) +
-                                (!right_edge && getNumber(BOARD(x + 1, y)) == 9) +
-                                (!right_edge && !bottom_edge && getNumber(BOARD(x + 1, y + 1)) == 9) +
-
-                                (!top_edge && getNumber(BOARD(x, y - 1)) == 9) +
-                                (!bottom_edge && getNumber(BOARD(x, y + 1)) == 9);
-      // clang-format on
-      BOARD(x, y) = setDisplayState(neighbors, getDisplayState(BOARD(x, y)));
-    }
+  double total = 0.0;
+  for (int i = 0; i < replay_frame_count; ++i) {
+    total += replay_frame_ms[i];
   }
+  qsort(replay_frame_ms, replay_frame_count, sizeof(float), compareFloats);
+  printf("replay: %d frames in %.3f s, frame time mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+         replay_frame_count, total * 1e-3, total / replay_frame_count, replay_frame_ms[(replay_frame_count - 1) * 50 / 100],
+         replay_frame_ms[(replay_frame_count - 1) * 95 / 100], replay_frame_ms[(replay_frame_count - 1) * 99 / 100],
+         replay_frame_ms[replay_frame_count - 1]);
 }
 
-void revealMines(uint8_t *board) {
-  for (int y = 0; y < board_height; ++y) {
-    for (int x = 0; x < board_width; ++x) {
-      const uint8_t display_state = getDisplayState(BOARD(x, y));
-      const uint8_t number = getNumber(BOARD(x, y));
-      if (number == 9 && display_state != cell_display_state_mistake && display_state != cell_display_state_flagged) {
-        BOARD(x, y) = setDisplayState(number, cell_display_state_mine);
-      }
-      if (display_state == cell_display_state_flagged && number != 9) {
-        BOARD(x, y) = setDisplayState(number, cell_display_state_flag_mistake);
-      }
-    }
-  }
+// The atlas PNG is decoded on a worker while InitWindow runs, only the upload to the GPU needs the window
+typedef struct AtlasDecode {
+  Image image;
+  uint64_t nanoseconds;
+} AtlasDecode;
+
+static int decodeAtlas(void *arg) {
+  AtlasDecode *decode = arg;
+  const uint64_t start = getNanoseconds();
+  decode->image = LoadImage("resources/texture_atlas.png");
+  decode->nanoseconds = getNanoseconds() - start;
+  return 0;
 }
 
-void revealFlags(uint8_t *board) {
-  for (int y = 0; y < board_height; ++y) {
-    for (int x = 0; x < board_width; ++x) {
-      if (getNumber(BOARD(x, y)) == 9 && getDisplayState(BOARD(x, y)) != cell_display_state_flagged) {
-        toggleFlagged(board, x, y);
-      }
-    }
+// Time from entering main to each startup milestone, printed by --startup-profile
+typedef enum StartupMark {
+  STARTUP_INIT_WINDOW,
+  STARTUP_ATLAS,
+  STARTUP_RENDER_TARGET,
+  STARTUP_FIRST_FRAME,
+  STARTUP_MARK_COUNT
+} StartupMark;
+
+const char *startup_mark_names[STARTUP_MARK_COUNT] = {"InitWindow", "atlas", "render target", "first frame"};
+
+void printStartupProfile(const uint64_t *marks, uint64_t start, uint64_t atlas_decode, uint64_t atlas_wait) {
+  uint64_t previous = start;
+  for (int mark = 0; mark < STARTUP_MARK_COUNT; ++mark) {
+    printf("startup: %-14s %8.2f ms, %8.2f ms since start\n", startup_mark_names[mark], (marks[mark] - previous) * 1e-6,
+           (marks[mark] - start) * 1e-6);
+    previous = marks[mark];
   }
+  printf("startup: atlas decoded on a worker in %.2f ms, the main thread waited %.2f ms for it\n", atlas_decode * 1e-6,
+         atlas_wait * 1e-6);
 }
 
-bool checkWin(uint8_t *board) {
-  for (int y = 0; y < board_height; ++y) {
-    for (int x = 0; x < board_width; ++x) {
-      if (getNumber(BOARD(x, y)) != 9 && getDisplayState(BOARD(x, y)) != cell_display_state_open) {
-        return false;
+// minesweeper [--record-input file | --replay-input file] [--view-replay file] [--import file] [--strict-alloc]
+//             [--startup-profile]
+// --view-replay plays back a saved game: space pauses, + and - change the speed, left and right skip 5 seconds, the bar
+// under the board seeks and the face button starts over. Starting a new game from the dialog leaves the viewer.
+// --import starts from a layout instead of the autosave, layouts can also be dropped on the window.
+// F6 copies a share code of the current board to the clipboard, F7 plays the board of a share code from the clipboard.
+// --startup-profile prints how long each startup step took and quits after the first presented frame, so
+// time-to-first-frame can be benchmarked in a loop (under Xvfb on a headless machine).
+// --strict-alloc aborts on any allocation made during a frame, the memory summary on exit counts them either way. Engine
+// and grading scratch are sized with the board. Exempt are starting a new game from the dialog, saving, loading and
+// importing, appending statistics, blocking no-guess generation, growth of the solver, bot queue and replay recording
+// (kept across games, so they stop once warmed up), floods deeper than the reserved stack and writes that overflow the
+// I/O ring.
+// A replay runs without vsync and quits at the end of the recording. Layouts are only reproduced when they come from the
+// recorded seed on the main thread, so the pregeneration pool is bypassed while recording and replaying. No-guess layouts
+// and the bot (both depend on how much work fits in a time budget) can still play out differently.
+int main(int argc, char **argv) {
+  const uint64_t startup_start = getNanoseconds();
+  if (argc > 1 && strcmp(argv[1], "--bot") == 0) {
+    return runHeadlessBot(argc - 2, argv + 2);
+  }
+
+  bool startup_profile = false;
+  bool viewing = false;
+  Replay viewed_replay = {0};
+  const char *import_path = NULL;
+  uint64_t seed = (uint64_t)time(NULL);
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 < argc && strcmp(argv[i], "--record-input") == 0) {
+      if (!inputStartRecording(argv[++i], seed)) {
+        return 1;
+      }
+    } else if (i + 1 < argc && strcmp(argv[i], "--replay-input") == 0) {
+      if (!inputStartReplay(argv[++i], &seed)) {
+        return 1;
       }
+    } else if (i + 1 < argc && strcmp(argv[i], "--view-replay") == 0) {
+      if (!replayLoad(argv[++i], &viewed_replay)) {
+        return 1;
+      }
+      viewing = true;
+      board_width = viewed_replay.width;
+      board_height = viewed_replay.height;
+      num_mines = viewed_replay.mines;
+    } else if (i + 1 < argc && strcmp(argv[i], "--import") == 0) {
+      import_path = argv[++i];
+    } else if (strcmp(argv[i], "--strict-alloc") == 0) {
+      memSetStrict(true);
+    } else if (strcmp(argv[i], "--startup-profile") == 0) {
+      startup_profile = true;
+    } else {
+      fprintf(stderr, "usage: minesweeper [--bot [width height mines [games]] | [--record-input file | --replay-input file] "
+                      "[--view-replay file] [--import file] [--strict-alloc] [--startup-profile]]\n");
+      return 1;
     }
   }
-  return true;
-}
-
-void resetGame(uint8_t *board) {
-  memset(board, 0, sizeof(uint8_t) * board_width * board_height);
-  mines_left = num_mines;
-  game_running = true;
-  game_over = false;
-  is_first_open = true;
-  timer_running = false;
-  timer = 0;
-}
+  const bool replaying = inputMode() == INPUT_REPLAY;
+  // Recorded sessions start from a new game so they replay the same way
+  SavedGame resumed = {0};
+  if (import_path && (viewing || !importLayout(import_path, &resumed))) {
+    return 1;
+  }
+  const bool resuming = import_path || (!viewing && inputMode() == INPUT_LIVE && loadGame(autosave_path, &resumed));
+  if (resuming) {
+    board_width = resumed.width;
+    board_height = resumed.height;
+  }
 
-void resizeBoard(uint8_t **board, int new_width, int new_height, RenderTexture2D *render_target) {
-  board_width = new_width;
-  board_height = new_height;
-  *board = realloc(*board, sizeof(uint8_t) * board_width * board_height);
-  render_width = 40 + board_width * 20;
-  render_height = 110 + board_height * 20;
-  SetWindowSize(render_width * scale, render_height * scale);
-  UnloadRenderTexture(*render_target);
-  *render_target = LoadRenderTexture(render_width, render_height);
-}
+  TRACE_THREAD_NAME("main");
+  uint64_t startup_marks[STARTUP_MARK_COUNT] = {0};
+  AtlasDecode atlas_decode = {0};
+  thrd_t atlas_thread;
+  const bool atlas_threaded = thrd_create(&atlas_thread, decodeAtlas, &atlas_decode) == thrd_success;
 
-int main(void) {
-  SetConfigFlags(FLAG_VSYNC_HINT);
+  // Replays measure how long frames take, not how long vsync waits
+  SetConfigFlags(replaying ? 0 : FLAG_VSYNC_HINT);
   render_width = 40 + board_width * 20;
   render_height = 110 + board_height * 20;
   InitWindow(render_width * scale, render_height * scale, "minesweeper");
+  startup_marks[STARTUP_INIT_WINDOW] = getNanoseconds();
 
-  srand(time(NULL));
+  seedRandom(seed);
 
-  uint8_t *board = malloc(sizeof(uint8_t) * board_width * board_height);
+  uint8_t *board = allocateBoard(NULL, board_width * board_height);
+  resizeGradeScratch(board, board_width * board_height);
+  reserveEngineScratch(board_width, board_height);
   if (num_mines > board_width * board_height - 1) {
     num_mines = board_width * board_height - 1;
   }
   resetGame(board);
+  ReplayPlayer player = {0};
+  if (viewing) {
+    replayPlayerInit(&player, &viewed_replay, board);
+  }
+
+  ioStart();
+  pregenStart();
+  pregenConfigure(board_width, board_height, num_mines, no_guess);
+  // Replayed sessions would log the same games again
+  stats_open = !replaying && statsOpen(&stats, stats_log_path, stats_index_path);
+  replayWriterReserve(&game_replay, 16 * 1024);
+  replay_recorder = viewing ? NULL : &game_replay;
+  if (resuming) {
+    resumeGame(&resumed, board);
+    savedGameFree(&resumed);
+    pregenConfigure(board_width, board_height, num_mines, no_guess);
+  }
 
-  int mines_text_length = snprintf(NULL, 0, "%d", mines_left) + 1;
-  char *mines_text = malloc(sizeof(char) * mines_text_length);
+  // Sized for the longest values so the counters never reallocate during a frame
+  const int mines_text_length = snprintf(NULL, 0, "%d", INT_MIN) + 1;
+  char *mines_text = memAlloc(MEM_TEXT, sizeof(char) * mines_text_length);
   snprintf(mines_text, mines_text_length, "%d", mines_left);
-  int timer_text_length = snprintf(NULL, 0, "%u", timer) + 1;
-  char *timer_text = malloc(sizeof(char) * timer_text_length);
+  const int timer_text_length = snprintf(NULL, 0, "%u", UINT32_MAX) + 1;
+  char *timer_text = memAlloc(MEM_TEXT, sizeof(char) * timer_text_length);
   snprintf(timer_text, timer_text_length, "%u", timer);
 
-  Image texture_atlas_image = LoadImage("resources/texture_atlas.png");
+  const uint64_t atlas_wait_start = getNanoseconds();
+  if (atlas_threaded) {
+    thrd_join(atlas_thread, NULL);
+  } else {
+    decodeAtlas(&atlas_decode);
+  }
+  const uint64_t atlas_wait = getNanoseconds() - atlas_wait_start;
+  Image texture_atlas_image = atlas_decode.image;
   const Color background_color = GetImageColor(texture_atlas_image, atlas_rects[ATLAS_BACKGROUND].x, atlas_rects[ATLAS_BACKGROUND].y);
   const Color foreground_color = GetImageColor(texture_atlas_image, atlas_rects[ATLAS_FOREGROUND].x, atlas_rects[ATLAS_FOREGROUND].y);
   Texture2D texture_atlas = LoadTextureFromImage(texture_atlas_image);
+  memAccount(MEM_RENDER, textureBytes(texture_atlas));
   SetTextureFilter(texture_atlas, TEXTURE_FILTER_POINT);
   UnloadImage(texture_atlas_image);
+  startup_marks[STARTUP_ATLAS] = getNanoseconds();
 
   RenderTexture2D render_target = LoadRenderTexture(render_width, render_height);
+  memAccount(MEM_RENDER, textureBytes(render_target.texture));
   SetTextureFilter(render_target.texture, TEXTURE_FILTER_POINT);
+  startup_marks[STARTUP_RENDER_TARGET] = getNanoseconds();
 
-  while (!WindowShouldClose()) {
-    Vector2 top_left = (Vector2){20.0f, 90.0f};
+  Solver hint_solver = {0};
+  Bot bot = {0};
+  FrameTimer frame_timer = {0};
 
+  uint64_t replay_frame_start = getNanoseconds();
+  while (!WindowShouldClose()) {
     // Apply the same transformation as the virtual mouse to the real mouse (i.e. to work with raygui)
     SetMouseScale(1.0f / scale, 1.0f / scale);
+    if (!inputBeginFrame()) {
+      break;
+    }
+    if (replaying) {
+      const uint64_t now = getNanoseconds();
+      if (replay_frame_count == replay_frame_capacity) {
+        replay_frame_capacity = replay_frame_capacity ? replay_frame_capacity * 2 : 1024;
+        replay_frame_ms = realloc(replay_frame_ms, sizeof(float) * replay_frame_capacity);
+      }
+      // The first frame's time is startup, not a frame
+      if (now != replay_frame_start) {
+        replay_frame_ms[replay_frame_count++] = (now - replay_frame_start) * 1e-6f;
+      }
+      replay_frame_start = now;
+    }
+    memSetHotPath(true);
+
+    TRACE_BEGIN(frame);
+    TRACE_BEGIN(input);
+    frameTimerBegin(&frame_timer);
+    if (IsKeyPressed(KEY_F3)) {
+      frameTimerEnable(&frame_timer, !frame_timer.enabled);
+    }
+    if (IsKeyPressed(KEY_F4)) {
+      TRACE_DUMP("minesweeper-trace.json");
+    }
+    if (!viewing && (IsKeyPressed(KEY_F5) || IsKeyPressed(KEY_F9))) {
+      // Saving and loading are expected to allocate
+      memSetHotPath(false);
+      if (IsKeyPressed(KEY_F5)) {
+        saveGame(quicksave_path, board, elapsedMs());
+      } else {
+        SavedGame game;
+        // A save made just before may still be queued
+        ioFlush();
+        if (loadGame(quicksave_path, &game)) {
+          if (game.width != board_width || game.height != board_height) {
+            resizeBoard(&board, game.width, game.height, &render_target);
+          }
+          resumeGame(&game, board);
+          savedGameFree(&game);
+          pregenConfigure(board_width, board_height, num_mines, no_guess);
+          botReset(&bot);
+        }
+      }
+      memSetHotPath(true);
+    }
+    // F6 copies the share code of the current board, F7 starts the board of the share code on the clipboard. The clipboard
+    // isn't part of recorded input.
+    if (!viewing && inputMode() == INPUT_LIVE && IsKeyPressed(KEY_F6) && board_seeded) {
+      char code[SHARE_CODE_MAX];
+      shareCodeEncode(&board_id, code);
+      SetClipboardText(code);
+      printf("share code: %s\n", code);
+    }
+    BoardId shared_id;
+    bool shared = !viewing && inputMode() == INPUT_LIVE && IsKeyPressed(KEY_F7) && GetClipboardText() &&
+                  shareCodeDecode(GetClipboardText(), &shared_id);
+    if (shared && (shared_id.width > CUSTOM_SIZE_MAX || shared_id.height > CUSTOM_SIZE_MAX || shared_id.mines > CUSTOM_MINES_MAX)) {
+      printf("share code: %dx%d with %d mines is larger than a custom board can be\n", shared_id.width, shared_id.height,
+             shared_id.mines);
+      shared = false;
+    }
+    if (shared) {
+      memSetHotPath(false);
+      saveReplay();
+      if (shared_id.width != board_width || shared_id.height != board_height) {
+        resizeBoard(&board, shared_id.width, shared_id.height, &render_target);
+      }
+      num_mines = shared_id.mines;
+      no_guess = false;
+      resetGame(board);
+      generateSeededMines(board, &shared_id);
+      is_first_open = false;
+      replay_recorder = &game_replay;
+      timer_running = true;
+      timer_start = GetTime();
+      playOpen(board, shared_id.first_click % board_width, shared_id.first_click / board_width);
+      stats_game_flags = STATS_SHARED;
+      pregenConfigure(board_width, board_height, num_mines, no_guess);
+      botReset(&bot);
+      memSetHotPath(true);
+    }
+    // Dropped files aren't part of recorded input
+    if (!viewing && inputMode() == INPUT_LIVE && IsFileDropped()) {
+      memSetHotPath(false);
+      FilePathList files = LoadDroppedFiles();
+      SavedGame game;
+      if (files.count > 0 && importLayout(files.paths[0], &game)) {
+        if (game.width != board_width || game.height != board_height) {
+          resizeBoard(&board, game.width, game.height, &render_target);
+        }
+        resumeGame(&game, board);
+        savedGameFree(&game);
+        pregenConfigure(board_width, board_height, num_mines, no_guess);
+        botReset(&bot);
+      }
+      UnloadDroppedFiles(files);
+      memSetHotPath(true);
+    }
+
+    Vector2 top_left = (Vector2){20.0f, 90.0f};
+
     Vector2 mouse_pos = GetMousePosition();
 
     int mouse_cell_x, mouse_cell_y;
     const bool mouse_is_on_cell = findCollisionCell(mouse_pos, top_left, &mouse_cell_x, &mouse_cell_y);
-    if (game_running) {
+    // Speculatively generate for the cell the first click is most likely to land on
+    static int last_hover_x = -1;
+    static int last_hover_y = -1;
+    const int hover_x = is_first_open && game_running ? mouse_cell_x : -1;
+    const int hover_y = is_first_open && game_running ? mouse_cell_y : -1;
+    if (hover_x != last_hover_x || hover_y != last_hover_y) {
+      pregenHover(hover_x, hover_y);
+      last_hover_x = hover_x;
+      last_hover_y = hover_y;
+    }
+    if (game_running && !viewing) {
       const uint8_t mouse_display_state = getDisplayState(BOARD(mouse_cell_x, mouse_cell_y));
       static int last_press_x = 0;
       static int last_press_y = 0;
@@ -515,35 +740,26 @@ int main(void) {
       }
       if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
         if (mouse_is_on_cell) {
-          if (is_first_open) {
-            generateMines(board, mouse_cell_x, mouse_cell_y);
-            is_first_open = false;
+          const bool first_open = is_first_open;
+          const uint64_t open_start = getNanoseconds();
+          if (first_open) {
             timer_running = true;
             timer_start = GetTime();
-          }
-          bool open_result = openCell(board, mouse_cell_x, mouse_cell_y);
-          if (!open_result) {
-            // GAME OVER
-            timer_running = false;
-            game_running = false;
-            game_won = false;
-            game_over = true;
-            revealMines(board);
-          } else if (open_result) {
-            if (checkWin(board)) {
-              timer_running = false;
-              game_running = false;
-              game_won = true;
-              game_over = true;
-              revealFlags(board);
+            if (inputMode() == INPUT_LIVE && pregenTake(board, mouse_cell_x, mouse_cell_y)) {
+              is_first_open = false;
+              ++first_click_pool_hits;
             }
           }
+          playOpen(board, mouse_cell_x, mouse_cell_y);
+          if (first_open) {
+            first_click_latencies[first_click_count++ % FIRST_CLICK_SAMPLES] = (getNanoseconds() - open_start) * 1e-9;
+          }
         }
       }
       if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) {
         if (mouse_is_on_cell) {
           if (mouse_display_state == cell_display_state_closed || mouse_display_state == cell_display_state_flagged) {
-            toggleFlagged(board, mouse_cell_x, mouse_cell_y);
+            playFlag(board, mouse_cell_x, mouse_cell_y);
           }
         }
       }
@@ -607,53 +823,191 @@ int main(void) {
       if (IsMouseButtonReleased(MOUSE_BUTTON_MIDDLE)) {
         if (mouse_is_on_cell) {
           if (mouse_display_state == cell_display_state_open) {
-            bool open_result = openNeighbors(board, mouse_cell_x, mouse_cell_y);
-            if (!open_result) {
-              // GAME OVER
-              timer_running = false;
-              game_running = false;
-              game_won = false;
-              game_over = true;
-              revealMines(board);
-            } else if (open_result) {
-              if (checkWin(board)) {
-                timer_running = false;
-                game_running = false;
-                game_won = true;
-                game_over = true;
-                revealFlags(board);
-              }
-            }
+            playChord(board, mouse_cell_x, mouse_cell_y);
           }
         }
       }
       if (IsKeyPressed(KEY_SPACE)) {
         if (mouse_is_on_cell) {
           if (mouse_display_state == cell_display_state_closed || mouse_display_state == cell_display_state_flagged) {
-            toggleFlagged(board, mouse_cell_x, mouse_cell_y);
+            playFlag(board, mouse_cell_x, mouse_cell_y);
           } else if (mouse_display_state == cell_display_state_open) {
-            bool open_result = openNeighbors(board, mouse_cell_x, mouse_cell_y);
-            if (!open_result) {
-              // GAME OVER
-              timer_running = false;
-              game_running = false;
-              game_won = false;
-              game_over = true;
-              revealMines(board);
-            } else if (open_result) {
-              if (checkWin(board)) {
-                timer_running = false;
-                game_running = false;
-                game_won = true;
-                game_over = true;
-                revealFlags(board);
-              }
-            }
+            playChord(board, mouse_cell_x, mouse_cell_y);
           }
         }
       }
+
+      // Replays show the cell held down under the cursor, only changes are recorded
+      static int last_pressed_cell = -1;
+      const bool pressing = IsMouseButtonDown(MOUSE_BUTTON_LEFT) || IsMouseButtonDown(MOUSE_BUTTON_MIDDLE);
+      const int pressed_cell = mouse_is_on_cell && pressing ? mouse_cell_y * board_width + mouse_cell_x : -1;
+      if (pressed_cell != last_pressed_cell) {
+        replayWriterEvent(&game_replay, REPLAY_PRESS, pressed_cell);
+        last_pressed_cell = pressed_cell;
+      }
     }
 
+    // Replay viewer, playback follows GetTime so it also works under --replay-input
+    static bool viewer_paused = false;
+    static int viewer_speed = 0;
+    static double viewer_ms = 0.0;
+    static double viewer_last_time = 0.0;
+    const double viewer_now = GetTime();
+    if (viewing) {
+      const double duration = replayPlayerDuration(&player);
+      if (IsKeyPressed(KEY_SPACE)) {
+        viewer_paused = !viewer_paused;
+        if (!viewer_paused && viewer_ms >= duration) {
+          viewer_ms = 0.0;
+        }
+      }
+      if ((IsKeyPressed(KEY_EQUAL) || IsKeyPressed(KEY_KP_ADD)) && viewer_speed < VIEWER_SPEED_COUNT - 1) {
+        ++viewer_speed;
+      }
+      if ((IsKeyPressed(KEY_MINUS) || IsKeyPressed(KEY_KP_SUBTRACT)) && viewer_speed > 0) {
+        --viewer_speed;
+      }
+      if (IsKeyPressed(KEY_RIGHT)) {
+        viewer_ms += 5000.0;
+      }
+      if (IsKeyPressed(KEY_LEFT)) {
+        viewer_ms -= 5000.0;
+      }
+      if (!viewer_paused) {
+        viewer_ms += (viewer_now - viewer_last_time) * 1000.0 * viewer_speeds[viewer_speed];
+      }
+      viewer_ms = viewer_ms < 0.0 ? 0.0 : viewer_ms;
+      if (viewer_ms >= duration) {
+        viewer_ms = duration;
+        viewer_paused = true;
+      }
+      replayPlayerSeek(&player, replayPlayerPositionAt(&player, (uint32_t)viewer_ms));
+      timer = (uint32_t)(viewer_ms / 1000.0);
+    }
+    viewer_last_time = viewer_now;
+
+    frameTimerPhase(&frame_timer, FRAME_PHASE_INPUT);
+    TRACE_END(input);
+    TRACE_BEGIN(engine);
+
+    // Hint
+    static bool hint_active = false;
+    static bool hint_done = false;
+    static uint32_t hint_revision = 0;
+    static int hint_cell = -1;
+    static double hint_requested_time = 0.0;
+    static double hint_latency = 0.0;
+    if (game_running && !viewing && IsKeyPressed(KEY_H)) {
+      hint_active = true;
+      stats_game_flags |= is_first_open ? 0 : STATS_ASSISTED;
+      hint_revision = board_revision;
+      hint_requested_time = GetTime();
+      if (is_first_open) {
+        // The first click never hits a mine
+        hint_done = true;
+        hint_cell = (board_height / 2) * board_width + board_width / 2;
+        hint_solver.result = (SolverResult){hint_cell, true, true, 0.0f};
+        hint_latency = 0.0;
+      } else {
+        hint_done = false;
+        hint_cell = -1;
+        solverStart(&hint_solver, board, board_width, board_height, num_mines);
+      }
+    }
+    if (hint_active && (!game_running || hint_revision != board_revision)) {
+      hint_active = false;
+    }
+    if (hint_active && !hint_done) {
+      hint_done = solverStep(&hint_solver, hint_budget);
+      if (hint_solver.result.cell != hint_cell || hint_done) {
+        hint_cell = hint_solver.result.cell;
+        hint_latency = GetTime() - hint_requested_time;
+      }
+    }
+
+    // Bot
+    static bool bot_active = false;
+    static int bot_moves_per_frame = 1;
+    static double bot_start_time = 0.0;
+    static double bot_time = 0.0;
+    if (!viewing && IsKeyPressed(KEY_B)) {
+      bot_active = !bot_active;
+      if (bot_active) {
+        botReset(&bot);
+        bot_start_time = GetTime();
+        bot_time = 0.0;
+      }
+    }
+    if (!viewing && (IsKeyPressed(KEY_EQUAL) || IsKeyPressed(KEY_KP_ADD)) && bot_moves_per_frame < 4096) {
+      bot_moves_per_frame *= 2;
+    }
+    if (!viewing && (IsKeyPressed(KEY_MINUS) || IsKeyPressed(KEY_KP_SUBTRACT)) && bot_moves_per_frame > 1) {
+      bot_moves_per_frame /= 2;
+    }
+    if (bot_active && game_running) {
+      stats_game_flags |= STATS_ASSISTED;
+      // Shares the hint's frame budget, a move that would need more solving carries on next frame
+      const double frame_deadline = GetTime() + hint_budget;
+      for (int i = 0; i < bot_moves_per_frame; ++i) {
+        const double remaining = frame_deadline - GetTime();
+        if (remaining <= 0.0) {
+          break;
+        }
+        if (is_first_open) {
+          timer_running = true;
+          timer_start = GetTime();
+        }
+        if (botStep(&bot, board, remaining) != BOT_MOVED) {
+          break;
+        }
+      }
+      bot_time = GetTime() - bot_start_time;
+    }
+
+    if (game_over && game_replay.started) {
+      saveReplay();
+    }
+
+    // Grade the board once it is won
+    static bool win_graded = false;
+    static BoardMetrics win_metrics;
+    static double win_seconds = 0.0;
+    if (!game_over || !game_won || viewing) {
+      win_graded = false;
+    } else if (!win_graded) {
+      if (grade_scratch) {
+        computeBoardMetrics(board, board_width, board_height, grade_scratch, &win_metrics);
+      } else {
+        memSetHotPath(false);
+        int32_t *scratch = memAlloc(MEM_ENGINE, sizeof(int32_t) * board_width * board_height);
+        computeBoardMetrics(board, board_width, board_height, scratch, &win_metrics);
+        memFree(scratch);
+        memSetHotPath(true);
+      }
+      win_seconds = GetTime() - timer_start;
+      win_graded = true;
+    }
+
+    if (!game_over) {
+      stats_logged = false;
+    } else if (!stats_logged && !viewing) {
+      if (stats_open) {
+        // Appending writes the index, which allocates
+        memSetHotPath(false);
+        StatsRecord record = {.date = (int64_t)time(NULL), .width = board_width, .height = board_height, .mines = num_mines};
+        record.time_ms = game_won ? (uint32_t)(win_seconds * 1000.0) : elapsedMs();
+        record.bbbv = game_won ? (uint32_t)win_metrics.bbbv : 0;
+        record.flags = (game_won ? STATS_WON : 0) | (no_guess ? STATS_NO_GUESS : 0) | stats_game_flags;
+        statsAppend(&stats, &record);
+        memSetHotPath(true);
+      }
+      stats_logged = true;
+    }
+
+    frameTimerPhase(&frame_timer, FRAME_PHASE_ENGINE);
+    TRACE_END(engine);
+    TRACE_BEGIN(board);
+
     // BeginDrawing();
     BeginTextureMode(render_target);
 
@@ -690,13 +1044,52 @@ int main(void) {
       }
     }
 
+    // The cell held down in the replay
+    if (viewing && player.pressed_cell >= 0 && getDisplayState(board[player.pressed_cell]) == cell_display_state_closed) {
+      const Vector2 pressed_top_left =
+          Vector2Add(top_left, (Vector2){(player.pressed_cell % board_width) * 20.0f, (player.pressed_cell / board_width) * 20.0f});
+      DrawTextureRec(texture_atlas, atlas_rects[ATLAS_OPEN], pressed_top_left, WHITE);
+    }
+
+    // Hint overlay
+    if (hint_active) {
+      if (hint_cell >= 0) {
+        const Rectangle hint_rect = {top_left.x + (hint_cell % board_width) * 20.0f, top_left.y + (hint_cell / board_width) * 20.0f, 20.0f,
+                                     20.0f};
+        DrawRectangleLinesEx(hint_rect, 2.0f, hint_solver.result.certain ? GREEN : ORANGE);
+      }
+      const char *hint_text;
+      if (hint_cell < 0) {
+        hint_text = hint_done ? "Hint: nothing to open" : "Hint: thinking...";
+      } else if (hint_solver.result.certain) {
+        hint_text = TextFormat("Hint: %.1f ms, safe", hint_latency * 1000.0);
+      } else {
+        hint_text = TextFormat("Hint: %.1f ms, %s%.0f%% safe%s", hint_latency * 1000.0, hint_solver.result.exact ? "" : "~",
+                               (1.0f - hint_solver.result.mine_probability) * 100.0f, hint_done ? "" : ", refining");
+      }
+      DrawText(hint_text, 20, render_height - 16, 10, foreground_color);
+    }
+
+    // Bot overlay
+    if (bot_active) {
+      const char *outcome = game_running ? "" : (game_won ? ", won" : (game_over ? ", lost" : ""));
+      const char *bot_text = TextFormat("Bot x%d: %llu moves, %.0f/s, %.2f s%s", bot_moves_per_frame, (unsigned long long)bot.moves,
+                                        bot_time > 0.0 ? bot.moves / bot_time : 0.0, bot_time, outcome);
+      DrawText(bot_text, 20, render_height - (hint_active ? 28 : 16), 10, foreground_color);
+    }
+
+    // Win efficiency, under the face button
+    if (win_graded) {
+      const char *win_text = TextFormat("3BV %d, %.2f 3BV/s", win_metrics.bbbv, win_seconds > 0.0 ? win_metrics.bbbv / win_seconds : 0.0);
+      DrawText(win_text, (render_width - MeasureText(win_text, 10)) / 2, 78, 10, foreground_color);
+    }
+
+    frameTimerPhase(&frame_timer, FRAME_PHASE_BOARD);
+    TRACE_END(board);
+    TRACE_BEGIN(ui);
+
     // Draw UI
     // Mines counter
-    int new_text_length;
-    if ((new_text_length = snprintf(NULL, 0, "%d", mines_left) + 1) > mines_text_length) {
-      mines_text_length = new_text_length;
-      mines_text = realloc(mines_text, sizeof(char) * mines_text_length);
-    }
     snprintf(mines_text, mines_text_length, "%d", mines_left);
     DrawText(mines_text, 20, 40, 30, foreground_color);
 
@@ -704,10 +1097,6 @@ int main(void) {
     if (timer_running) {
       timer = (int)(GetTime() - timer_start);
     }
-    if ((new_text_length = snprintf(NULL, 0, "%u", timer) + 1) > timer_text_length) {
-      timer_text_length = new_text_length;
-      timer_text = realloc(timer_text, sizeof(char) * timer_text_length);
-    }
     snprintf(timer_text, timer_text_length, "%u", timer);
     DrawText(timer_text, render_width - 20 - MeasureText(timer_text, 30), 40, 30, foreground_color);
 
@@ -717,7 +1106,7 @@ int main(void) {
       DrawTexturePro(texture_atlas, atlas_rects[ATLAS_FACE_PRESSED], button, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
     } else {
       DrawTexturePro(texture_atlas, atlas_rects[ATLAS_FACE_SMILE], button, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
-      if (game_running) {
+      if (game_running || viewing) {
         if (game_over && game_won) {
           DrawTexturePro(texture_atlas, atlas_rects[ATLAS_FACE_WIN], button, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
         } else if (game_over && !game_won) {
@@ -727,7 +1116,29 @@ int main(void) {
         }
       }
       if (CheckCollisionPointRec(mouse_pos, button) && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
-        resetGame(board);
+        if (viewing) {
+          viewer_ms = 0.0;
+          viewer_paused = false;
+        } else {
+          saveReplay();
+          resetGame(board);
+          replay_recorder = &game_replay;
+          stats_game_flags = 0;
+        }
+      }
+    }
+
+    // Replay position and speed under the face button, seek bar under the board
+    if (viewing) {
+      const float duration = (float)replayPlayerDuration(&player);
+      const char *viewer_text = TextFormat("x%d %.1f / %.1f s%s", viewer_speeds[viewer_speed], viewer_ms / 1000.0, duration / 1000.0f,
+                                           viewer_paused ? ", paused" : "");
+      DrawText(viewer_text, (render_width - MeasureText(viewer_text, 10)) / 2, 78, 10, foreground_color);
+      float seek_ms = (float)viewer_ms;
+      GuiSliderBar((Rectangle){20.0f, render_height - 16.0f, render_width - 40.0f, 12.0f}, NULL, NULL, &seek_ms, 0.0f, duration);
+      if (seek_ms != (float)viewer_ms) {
+        viewer_ms = seek_ms;
+        replayPlayerSeek(&player, replayPlayerPositionAt(&player, (uint32_t)viewer_ms));
       }
     }
 
@@ -753,10 +1164,10 @@ int main(void) {
     if (show_game_dialog) {
       game_running = false; // Make sure can't start game with dialogue open
 
-      Rectangle dialog_bounds = {(float)render_width * 0.5f - 90.0f, 10.0f * (float)board_height, 180.0f, 180.0f};
+      Rectangle dialog_bounds = {(float)render_width * 0.5f - 90.0f, 10.0f * (float)board_height, 180.0f, 200.0f};
       const int result = GuiWindowBox(dialog_bounds, "Game Options");
 
-      Rectangle inner_bounds = {dialog_bounds.x + 10.0f, dialog_bounds.y + 28.0f, 160.0f, 142.0f};
+      Rectangle inner_bounds = {dialog_bounds.x + 10.0f, dialog_bounds.y + 28.0f, 160.0f, 162.0f};
       GuiLabel((Rectangle){inner_bounds.x, inner_bounds.y, inner_bounds.width, ui_height}, "Mode:");
       static int active = 0;
       static bool dropdown_active = false;
@@ -776,27 +1187,38 @@ int main(void) {
       } else {
         static bool width_edit_mode = false;
         if (GuiValueBox((Rectangle){inner_bounds.x + 80.0f, inner_bounds.y + 45.0f, inner_bounds.width * 0.5f, ui_height}, NULL,
-                        &custom_board_width, 1, 1000, width_edit_mode)) {
+                        &custom_board_width, 1, CUSTOM_SIZE_MAX, width_edit_mode)) {
           width_edit_mode = !width_edit_mode;
         }
 
         static bool height_edit_mode = false;
         if (GuiValueBox((Rectangle){inner_bounds.x + 80.0f, inner_bounds.y + 70.0f, inner_bounds.width * 0.5f, ui_height}, NULL,
-                        &custom_board_height, 1, 1000, height_edit_mode)) {
+                        &custom_board_height, 1, CUSTOM_SIZE_MAX, height_edit_mode)) {
           height_edit_mode = !height_edit_mode;
         }
 
         static bool mines_edit_mode = false;
         if (GuiValueBox((Rectangle){inner_bounds.x + 80.0f, inner_bounds.y + 95.0f, inner_bounds.width * 0.5f, ui_height}, NULL,
-                        &custom_mines, 1, 1000, mines_edit_mode)) {
+                        &custom_mines, 1, CUSTOM_MINES_MAX, mines_edit_mode)) {
           mines_edit_mode = !mines_edit_mode;
         }
       }
 
-      if (GuiButton((Rectangle){inner_bounds.x, dialog_bounds.y + 150.0f, inner_bounds.width, ui_height}, "Start Game")) {
+      static bool no_guess_checked = false;
+      GuiCheckBox((Rectangle){inner_bounds.x, inner_bounds.y + 122.0f, 15.0f, 15.0f}, "No guessing", &no_guess_checked);
+
+      if (GuiButton((Rectangle){inner_bounds.x, dialog_bounds.y + 172.0f, inner_bounds.width, ui_height}, "Start Game")) {
+        // Setting up a new board is expected to allocate
+        memSetHotPath(false);
         show_game_dialog = false;
         game_running = true;
         timer_running = false;
+        no_guess = no_guess_checked;
+        if (viewing) {
+          replayPlayerFree(&player);
+          viewing = false;
+        }
+        replay_recorder = &game_replay;
         if (active != 3) {
           resizeBoard(&board, difficulty_nums[active * 3 + 0], difficulty_nums[active * 3 + 1], &render_target);
           num_mines = difficulty_nums[active * 3 + 2];
@@ -807,7 +1229,11 @@ int main(void) {
           }
           num_mines = custom_mines;
         }
+        saveReplay();
         resetGame(board);
+        stats_game_flags = 0;
+        pregenConfigure(board_width, board_height, num_mines, no_guess);
+        memSetHotPath(true);
       }
 
       if (GuiDropdownBox((Rectangle){inner_bounds.x, inner_bounds.y + 20.0f, inner_bounds.width, ui_height},
@@ -857,26 +1283,142 @@ int main(void) {
       }
     }
 
+    // Statistics of the current difficulty, everything shown comes from the index so it doesn't depend on how many games
+    // were logged
+    static bool show_stats = false;
+    if (IsKeyPressed(KEY_F2)) {
+      show_stats = !show_stats;
+    }
+    if (show_stats) {
+      const StatsDifficulty *difficulty = stats_open ? statsFind(&stats, board_width, board_height, num_mines, no_guess) : NULL;
+      const int line_height = 11;
+      const int lines = difficulty ? 4 + difficulty->num_best : 2;
+      const Rectangle panel = {4.0f, 22.0f, render_width - 8.0f, lines * line_height + 8.0f};
+      DrawRectangleRec(panel, Fade(BLACK, 0.75f));
+      int text_y = (int)panel.y + 4;
+      DrawText(TextFormat("%dx%d, %d mines%s", board_width, board_height, num_mines, no_guess ? ", no guessing" : ""), 8, text_y, 10,
+               WHITE);
+      if (!difficulty) {
+        DrawText(stats_open ? "no games yet" : "statistics unavailable", 8, text_y += line_height, 10, WHITE);
+      } else {
+        DrawText(TextFormat("%u games, %u won (%.1f%%)", difficulty->games, difficulty->wins, 100.0 * difficulty->wins / difficulty->games),
+                 8, text_y += line_height, 10, WHITE);
+        const double mean = difficulty->ranked_wins ? difficulty->ranked_ms / 1000.0 / difficulty->ranked_wins : 0.0;
+        DrawText(TextFormat("mean %.2f p50 %.2f p90 %.2f s", mean, statsPercentile(difficulty, 0.5) / 1000.0,
+                            statsPercentile(difficulty, 0.9) / 1000.0),
+                 8, text_y += line_height, 10, WHITE);
+        DrawText("best times:", 8, text_y += line_height, 10, WHITE);
+        for (int i = 0; i < difficulty->num_best; ++i) {
+          const StatsBest *best = &difficulty->best[i];
+          const time_t date = (time_t)best->date;
+          char date_text[16];
+          strftime(date_text, sizeof(date_text), "%Y-%m-%d", localtime(&date));
+          DrawText(TextFormat("%2d. %.3f s, 3BV %u, %s", i + 1, best->time_ms / 1000.0, best->bbbv, date_text), 8,
+                   text_y += line_height, 10, WHITE);
+        }
+      }
+    }
+
+    // Frame time overlay, statistics are refreshed a few times a second to keep the overlay itself cheap
+    if (frame_timer.enabled) {
+      static FrameStats frame_stats;
+      static int frame_stats_age = 0;
+      if (frame_stats_age-- <= 0) {
+        frameTimerStats(&frame_timer, &frame_stats);
+        frame_stats_age = 15;
+      }
+      const int line_height = 11;
+      const int graph_height = 30;
+      const Rectangle panel = {4.0f, 22.0f, render_width - 8.0f, (FRAME_PHASE_COUNT + 2) * line_height + graph_height + 10.0f};
+      DrawRectangleRec(panel, Fade(BLACK, 0.75f));
+      int text_y = (int)panel.y + 4;
+      DrawText(TextFormat("frame p50 %.2f p95 %.2f ms", frame_stats.p50, frame_stats.p95), 8, text_y, 10, WHITE);
+      DrawText(TextFormat("p99 %.2f max %.2f ms", frame_stats.p99, frame_stats.max), 8, text_y += line_height, 10, WHITE);
+      for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+        DrawText(TextFormat("%-8s %6.3f ms", frame_phase_names[phase], frame_stats.phase_mean[phase]), 8, text_y += line_height, 10,
+                 WHITE);
+      }
+      // Most recent frames, newest on the right, full height is 33.3 ms with a line at 16.7 ms
+      const int graph_bottom = text_y + line_height + graph_height + 2;
+      const int bars = frame_timer.count < (int)panel.width - 8 ? frame_timer.count : (int)panel.width - 8;
+      for (int i = 0; i < bars; ++i) {
+        const float ms = frame_timer.frame_ms[(frame_timer.head - bars + i + FRAME_SAMPLES) % FRAME_SAMPLES];
+        const int height = ms >= 33.3f ? graph_height : (int)(ms / 33.3f * graph_height);
+        DrawLine(8 + i, graph_bottom, 8 + i, graph_bottom - height, ms > 17.0f ? ORANGE : GREEN);
+      }
+      DrawLine(8, graph_bottom - graph_height / 2, (int)(panel.x + panel.width) - 4, graph_bottom - graph_height / 2, Fade(WHITE, 0.5f));
+    }
+
     // EndDrawing();
     EndTextureMode();
 
+    frameTimerPhase(&frame_timer, FRAME_PHASE_UI);
+    TRACE_END(ui);
+    TRACE_BEGIN(present);
+
     BeginDrawing();
 
     DrawTexturePro(render_target.texture, (Rectangle){0.0f, 0.0f, (float)render_width, (float)-render_height},
                    (Rectangle){0.0f, 0.0f, (float)render_width * scale, (float)render_height * scale}, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
 
     EndDrawing();
+
+    frameTimerPhase(&frame_timer, FRAME_PHASE_PRESENT);
+    frameTimerEnd(&frame_timer);
+    TRACE_END(present);
+    TRACE_END(frame);
+    memSetHotPath(false);
+
+    if (startup_marks[STARTUP_FIRST_FRAME] == 0) {
+      startup_marks[STARTUP_FIRST_FRAME] = getNanoseconds();
+      if (startup_profile) {
+        printStartupProfile(startup_marks, startup_start, atlas_decode.nanoseconds, atlas_wait);
+        break;
+      }
+    }
   }
 
+  // Only a game in progress is resumed
+  if (!viewing && inputMode() == INPUT_LIVE) {
+    if (!is_first_open && !game_over) {
+      saveGame(autosave_path, board, elapsedMs());
+    } else {
+      ioRemove(autosave_path);
+    }
+  }
+
+  memAccount(MEM_RENDER, -textureBytes(texture_atlas));
   UnloadTexture(texture_atlas);
 
+  memAccount(MEM_RENDER, -textureBytes(render_target.texture));
   UnloadRenderTexture(render_target);
 
+  solverFree(&hint_solver);
+  botFree(&bot);
+  statsClose(&stats);
+  replayPlayerFree(&player);
+
   CloseWindow();
 
-  free(mines_text);
-  free(timer_text);
-  free(board);
+  pregenStop();
+  saveReplay();
+  replay_recorder = NULL;
+  replayWriterFree(&game_replay);
+  ioStop();
+  printFirstClickLatency();
+  printEngineCounters();
+  ioPrintStats();
+  printReplayFrameTimes();
+  TRACE_DUMP("minesweeper-trace.json");
+  inputStop();
+
+  memFree(mines_text);
+  free(replay_frame_ms);
+  memFree(timer_text);
+  memFree(grade_scratch);
+  freeEngineScratch();
+  freeBoard(board);
+  memPrintStats();
 
   return 0;
 }
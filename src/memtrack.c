@@ -0,0 +1,146 @@
+#include "memtrack.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "threadlocal.h"
+
+const char *mem_category_names[MEM_CATEGORY_COUNT] = {"board", "text", "render", "solver", "engine", "generation", "bot", "replay",
+                                                      "stats", "io"};
+
+// Every block starts with its size so frees and reallocs can be accounted without the caller passing it
+typedef union MemHeader {
+  struct {
+    size_t size;
+    int category;
+  } info;
+  max_align_t align;
+} MemHeader;
+
+static _Atomic int64_t current_bytes[MEM_CATEGORY_COUNT];
+static _Atomic int64_t peak_bytes[MEM_CATEGORY_COUNT];
+static atomic_uint_fast64_t allocation_count[MEM_CATEGORY_COUNT];
+static atomic_uint_fast64_t hot_allocation_count[MEM_CATEGORY_COUNT];
+static _Atomic int64_t total_bytes;
+static _Atomic int64_t total_peak_bytes;
+static atomic_bool strict_mode;
+static thread_local bool on_hot_path = false;
+
+static void raisePeak(_Atomic int64_t *peak, int64_t value) {
+  int64_t seen = atomic_load_explicit(peak, memory_order_relaxed);
+  while (value > seen && !atomic_compare_exchange_weak_explicit(peak, &seen, value, memory_order_relaxed, memory_order_relaxed))
+    ;
+}
+
+void memAccount(MemCategory category, int64_t bytes) {
+  const int64_t now = atomic_fetch_add_explicit(&current_bytes[category], bytes, memory_order_relaxed) + bytes;
+  const int64_t total = atomic_fetch_add_explicit(&total_bytes, bytes, memory_order_relaxed) + bytes;
+  if (bytes > 0) {
+    raisePeak(&peak_bytes[category], now);
+    raisePeak(&total_peak_bytes, total);
+  }
+}
+
+static void countAllocation(MemCategory category, size_t size) {
+  atomic_fetch_add_explicit(&allocation_count[category], 1, memory_order_relaxed);
+  if (on_hot_path) {
+    atomic_fetch_add_explicit(&hot_allocation_count[category], 1, memory_order_relaxed);
+    if (atomic_load_explicit(&strict_mode, memory_order_relaxed)) {
+      fprintf(stderr, "memtrack: %zu byte %s allocation on the hot path\n", size, mem_category_names[category]);
+      abort();
+    }
+  }
+}
+
+// Callers don't check for NULL, running on without the memory would only crash somewhere less obvious
+static void outOfMemory(MemCategory category, size_t count, size_t size) {
+  fprintf(stderr, "memtrack: out of memory allocating %zu x %zu bytes of %s\n", count, size, mem_category_names[category]);
+  abort();
+}
+
+void *memAlloc(MemCategory category, size_t size) { return memRealloc(category, NULL, size); }
+
+void *memCalloc(MemCategory category, size_t count, size_t size) {
+  if (size > 0 && count > (SIZE_MAX - sizeof(MemHeader)) / size) {
+    outOfMemory(category, count, size);
+  }
+  countAllocation(category, count * size);
+  MemHeader *header = calloc(1, sizeof(MemHeader) + count * size);
+  if (!header) {
+    outOfMemory(category, count, size);
+  }
+  header->info.size = count * size;
+  header->info.category = category;
+  memAccount(category, (int64_t)header->info.size);
+  return header + 1;
+}
+
+void *memRealloc(MemCategory category, void *ptr, size_t size) {
+  if (size > SIZE_MAX - sizeof(MemHeader)) {
+    outOfMemory(category, 1, size);
+  }
+  countAllocation(category, size);
+  MemHeader *header = ptr ? (MemHeader *)ptr - 1 : NULL;
+  const size_t old_size = header ? header->info.size : 0;
+  MemHeader *grown = realloc(header, sizeof(MemHeader) + size);
+  if (!grown) {
+    // The old block is still valid and still accounted, give it back before giving up
+    if (header) {
+      memFree(ptr);
+    }
+    outOfMemory(category, 1, size);
+  }
+  header = grown;
+  header->info.size = size;
+  header->info.category = category;
+  memAccount(category, (int64_t)size - (int64_t)old_size);
+  return header + 1;
+}
+
+void memFree(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  MemHeader *header = (MemHeader *)ptr - 1;
+  memAccount(header->info.category, -(int64_t)header->info.size);
+  free(header);
+}
+
+bool memSetHotPath(bool hot) {
+  const bool was_hot = on_hot_path;
+  on_hot_path = hot;
+  return was_hot;
+}
+
+void memSetStrict(bool strict) { atomic_store(&strict_mode, strict); }
+
+void memGetStats(MemStats *stats) {
+  *stats = (MemStats){0};
+  for (int i = 0; i < MEM_CATEGORY_COUNT; ++i) {
+    stats->current[i] = atomic_load_explicit(&current_bytes[i], memory_order_relaxed);
+    stats->peak[i] = atomic_load_explicit(&peak_bytes[i], memory_order_relaxed);
+    stats->allocations[i] = atomic_load_explicit(&allocation_count[i], memory_order_relaxed);
+    stats->hot_allocations[i] = atomic_load_explicit(&hot_allocation_count[i], memory_order_relaxed);
+  }
+  stats->total_current = atomic_load_explicit(&total_bytes, memory_order_relaxed);
+  stats->total_peak = atomic_load_explicit(&total_peak_bytes, memory_order_relaxed);
+}
+
+void memPrintStats(void) {
+  MemStats stats;
+  memGetStats(&stats);
+  if (stats.total_peak == 0) {
+    return;
+  }
+  printf("memory: peak %.1f KiB, %.1f KiB still allocated\n", stats.total_peak / 1024.0, stats.total_current / 1024.0);
+  for (int i = 0; i < MEM_CATEGORY_COUNT; ++i) {
+    if (stats.peak[i] == 0) {
+      continue;
+    }
+    printf("  %-10s peak %10.1f KiB, current %10.1f KiB, %llu allocations (%llu on the hot path)\n", mem_category_names[i],
+           stats.peak[i] / 1024.0, stats.current[i] / 1024.0, (unsigned long long)stats.allocations[i],
+           (unsigned long long)stats.hot_allocations[i]);
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef MEMTRACK_H
+#define MEMTRACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Allocation wrappers that keep current and peak bytes per category, to see how memory scales with the board size.
+// Counters are shared by all threads.
+
+typedef enum MemCategory {
+  MEM_BOARD,      // the board itself
+  MEM_TEXT,       // counter strings
+  MEM_RENDER,     // render targets and textures, estimated since they live on the GPU
+  MEM_SOLVER,     // solver state and scratch
+  MEM_ENGINE,     // flood fill stack, mine placement tree, grading scratch
+  MEM_GENERATION, // pregeneration pool and no-guess workers
+  MEM_BOT,        // bot move queue
+  MEM_REPLAY,     // replay recording
+  MEM_STATS,      // statistics index
+  MEM_IO,         // queued file writes
+  MEM_CATEGORY_COUNT
+} MemCategory;
+
+extern const char *mem_category_names[MEM_CATEGORY_COUNT];
+
+typedef struct MemStats {
+  int64_t current[MEM_CATEGORY_COUNT];
+  int64_t peak[MEM_CATEGORY_COUNT];
+  uint64_t allocations[MEM_CATEGORY_COUNT];
+  uint64_t hot_allocations[MEM_CATEGORY_COUNT]; // made while the calling thread was on the hot path
+  int64_t total_current;
+  int64_t total_peak;
+} MemStats;
+
+void *memAlloc(MemCategory category, size_t size);
+void *memCalloc(MemCategory category, size_t count, size_t size);
+// ptr may be NULL, the category has to match the one it was allocated with
+void *memRealloc(MemCategory category, void *ptr, size_t size);
+void memFree(void *ptr);
+// Memory allocated by someone else (e.g. raylib textures), negative when it is released
+void memAccount(MemCategory category, int64_t bytes);
+
+// Marks the calling thread as being on the hot frame path. Allocations made there are counted separately, in strict mode
+// they abort with the category and size so the call site can be found in a debugger. Returns the previous state, so code
+// that is exempt from the checks can clear it and put it back.
+bool memSetHotPath(bool hot);
+void memSetStrict(bool strict);
+
+void memGetStats(MemStats *stats);
+// Current and peak bytes per category, for the summary on exit
+void memPrintStats(void);
+
+#endif
@@ -0,0 +1,90 @@
+#include "metrics.h"
+
+#include <string.h>
+
+#include "engine.h"
+
+// parent[i] is the parent of zero cell i, or -size at a root
+static int32_t findRoot(int32_t *parent, int32_t cell) {
+  while (parent[cell] >= 0) {
+    if (parent[parent[cell]] >= 0) {
+      parent[cell] = parent[parent[cell]];
+    }
+    cell = parent[cell];
+  }
+  return cell;
+}
+
+// Returns the size of the merged set, 0 if both were already in the same one
+static int32_t unite(int32_t *parent, int32_t a, int32_t b) {
+  a = findRoot(parent, a);
+  b = findRoot(parent, b);
+  if (a == b) {
+    return 0;
+  }
+  if (parent[a] > parent[b]) {
+    const int32_t swap = a;
+    a = b;
+    b = swap;
+  }
+  parent[a] += parent[b];
+  parent[b] = a;
+  return -parent[a];
+}
+
+void computeBoardMetrics(const uint8_t *board, int width, int height, int32_t *scratch, BoardMetrics *metrics) {
+  BoardMetrics result = {0};
+  // Number cells use scratch as a "revealed by an opening" flag, zero cells as their union-find parent
+  memset(scratch, 0, sizeof(int32_t) * width * height);
+  int revealed_numbers = 0;
+
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const int32_t cell = y * width + x;
+      const uint8_t number = getNumber(board[cell]);
+      if (number == 9) {
+        ++result.mines;
+        continue;
+      }
+      if (number != 0) {
+        ++result.number_cells;
+        continue;
+      }
+
+      // New zero cell starts as its own opening and merges with the already visited zero neighbors (W, NW, N, NE)
+      ++result.zero_cells;
+      ++result.openings;
+      scratch[cell] = -1;
+      if (result.largest_opening < 1) {
+        result.largest_opening = 1;
+      }
+      for (int ny = y - 1; ny <= y + 1; ++ny) {
+        for (int nx = x - 1; nx <= x + 1; ++nx) {
+          if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
+            continue;
+          }
+          const int32_t neighbor = ny * width + nx;
+          const uint8_t neighbor_number = getNumber(board[neighbor]);
+          if (neighbor_number != 0) {
+            if (neighbor_number != 9 && scratch[neighbor] == 0) {
+              scratch[neighbor] = 1;
+              ++revealed_numbers;
+            }
+          } else if (neighbor < cell) {
+            const int32_t size = unite(scratch, cell, neighbor);
+            if (size > 0) {
+              --result.openings;
+              if (size > result.largest_opening) {
+                result.largest_opening = size;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  result.isolated_numbers = result.number_cells - revealed_numbers;
+  result.bbbv = result.openings + result.isolated_numbers;
+  *metrics = result;
+}
@@ -0,0 +1,20 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+// Difficulty of a generated layout, only the number nibbles of the board are read
+typedef struct BoardMetrics {
+  int bbbv;             // 3BV: minimum number of left clicks needed to clear the board
+  int openings;         // connected regions of zero cells, each cleared by one click
+  int isolated_numbers; // numbered cells not touching any zero cell, each needs its own click
+  int zero_cells;
+  int number_cells;
+  int mines;
+  int largest_opening; // zero cells in the biggest opening
+} BoardMetrics;
+
+// Single raster pass with a union-find over zero cells. scratch must hold width * height entries.
+void computeBoardMetrics(const uint8_t *board, int width, int height, int32_t *scratch, BoardMetrics *metrics);
+
+#endif
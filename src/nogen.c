@@ -0,0 +1,162 @@
+#include "nogen.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "engine.h"
+#include "memtrack.h"
+#include "platform.h"
+#include "solver.h"
+#include "timing.h"
+#include "trace.h"
+
+typedef struct NoGuessJob {
+  int width;
+  int height;
+  int mines;
+  int start_x;
+  int start_y;
+  FirstClickPolicy policy;
+  uint64_t deadline;
+  uint8_t *result;
+  atomic_bool found;
+} NoGuessJob;
+
+typedef struct NoGuessWorker {
+  NoGuessJob *job;
+  uint64_t seed;
+  uint64_t candidates;
+  uint64_t accepted;
+} NoGuessWorker;
+
+// Plays the layout with proven moves only, true if that clears it
+static bool solvesWithoutGuessing(uint8_t *board, int start_x, int start_y, Solver *solver, atomic_bool *cancel) {
+  if (!openCell(board, start_x, start_y)) {
+    return false;
+  }
+  while (!checkWin(board)) {
+    if (atomic_load_explicit(cancel, memory_order_relaxed)) {
+      return false;
+    }
+    solverStart(solver, board, board_width, board_height, num_mines);
+    solverStep(solver, 0.0);
+    if (solver->num_safe == 0) {
+      return false;
+    }
+    for (int i = 0; i < solver->num_mines_found; ++i) {
+      const int cell = solver->mine_cells[i];
+      if (getDisplayState(board[cell]) == cell_display_state_closed) {
+        toggleFlagged(board, cell % board_width, cell / board_width);
+      }
+    }
+    for (int i = 0; i < solver->num_safe; ++i) {
+      const int cell = solver->safe_cells[i];
+      openCell(board, cell % board_width, cell / board_width);
+    }
+  }
+  return true;
+}
+
+// Generates and tries candidates until one of the workers found a layout or the deadline passed. Plays its candidates on
+// the calling thread's engine state.
+static void searchLayouts(NoGuessWorker *worker) {
+  NoGuessJob *job = worker->job;
+  board_width = job->width;
+  board_height = job->height;
+  num_mines = job->mines;
+  first_click_policy = job->policy;
+  cell_changes = NULL;
+  seedRandom(worker->seed);
+
+  const int cells = job->width * job->height;
+  uint8_t *layout = memAlloc(MEM_GENERATION, sizeof(uint8_t) * cells);
+  uint8_t *board = memAlloc(MEM_GENERATION, sizeof(uint8_t) * cells);
+  Solver solver = {0};
+  while (!atomic_load_explicit(&job->found, memory_order_relaxed) && getNanoseconds() < job->deadline) {
+    resetGame(layout);
+    generateMines(layout, job->start_x, job->start_y);
+    memcpy(board, layout, sizeof(uint8_t) * cells);
+    if (!solvesWithoutGuessing(board, job->start_x, job->start_y, &solver, &job->found)) {
+      if (!atomic_load_explicit(&job->found, memory_order_relaxed)) {
+        ++worker->candidates;
+      }
+      continue;
+    }
+    ++worker->candidates;
+    ++worker->accepted;
+    bool expected = false;
+    if (atomic_compare_exchange_strong(&job->found, &expected, true)) {
+      memcpy(job->result, layout, sizeof(uint8_t) * cells);
+    }
+  }
+  solverFree(&solver);
+  memFree(board);
+  memFree(layout);
+}
+
+static int noGuessWorker(void *arg) {
+  TRACE_THREAD_NAME("no-guess");
+  searchLayouts(arg);
+  freeEngineScratch();
+  return 0;
+}
+
+bool generateNoGuessMines(uint8_t *board, int start_x, int start_y, int threads, double time_limit, NoGuessStats *stats) {
+  if (threads <= 0) {
+    threads = getCoreCount();
+  }
+  // Blocks for up to time_limit, what the job and its workers allocate is the least of it. Exempt from the hot path checks.
+  const bool hot = memSetHotPath(false);
+  const uint64_t start = getNanoseconds();
+  NoGuessJob job = {board_width, board_height, num_mines, start_x, start_y, first_click_policy, start + (uint64_t)(time_limit * 1e9),
+                    NULL, false};
+  job.result = memAlloc(MEM_GENERATION, sizeof(uint8_t) * board_width * board_height);
+
+  NoGuessWorker *workers = memCalloc(MEM_GENERATION, threads, sizeof(NoGuessWorker));
+  thrd_t *handles = memAlloc(MEM_GENERATION, sizeof(thrd_t) * threads);
+  int started = 0;
+  for (; started < threads; ++started) {
+    // Independent stream per worker, drawn from the caller's generator
+    workers[started] = (NoGuessWorker){&job, nextRandom(), 0, 0};
+    if (thrd_create(&handles[started], noGuessWorker, &workers[started]) != thrd_success) {
+      break;
+    }
+  }
+  for (int i = 0; i < started; ++i) {
+    thrd_join(handles[i], NULL);
+  }
+  // Without any worker the calling thread searches itself, with its own game put back afterwards
+  if (started == 0) {
+    EngineState state;
+    saveEngineState(&state);
+    searchLayouts(&workers[0]);
+    restoreEngineState(&state);
+  }
+
+  const bool found = atomic_load(&job.found);
+  // The workers' own counters die with them, the rejected layouts are charged to the thread that asked
+  for (int i = 0; i < threads; ++i) {
+    addGenerationRetries(workers[i].candidates - workers[i].accepted);
+  }
+  if (found) {
+    // Only the numbers, flags placed before the first click stay where they are
+    for (int i = 0; i < board_width * board_height; ++i) {
+      board[i] = setDisplayState(getNumber(job.result[i]), getDisplayState(board[i]));
+    }
+    ++board_revision;
+  }
+  if (stats) {
+    *stats = (NoGuessStats){0, 0, (getNanoseconds() - start) * 1e-9};
+    for (int i = 0; i < threads; ++i) {
+      stats->candidates += workers[i].candidates;
+      stats->accepted += workers[i].accepted;
+    }
+  }
+  memFree(handles);
+  memFree(workers);
+  memFree(job.result);
+  memSetHotPath(hot);
+  return found;
+}
@@ -0,0 +1,26 @@
+#ifndef NOGEN_H
+#define NOGEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// How long the first click may spend looking for a no-guess layout before falling back to a plain one. This is the
+// accepted worst case for a first click that misses the pregeneration pool: the search blocks the frame for up to this
+// long (expert boards usually take a few milliseconds, dense boards run into the limit) rather than leaving the game in
+// a half started state across frames.
+#define NO_GUESS_TIME_LIMIT 2.0
+
+typedef struct NoGuessStats {
+  uint64_t candidates; // layouts fully checked
+  uint64_t accepted;   // of those, solvable without guessing
+  double seconds;
+} NoGuessStats;
+
+// Generates candidate layouts around the start cell on every core and keeps the first one the solver clears without a
+// single guess, the other workers are cancelled as soon as one is found. Uses the calling thread's board_width,
+// board_height, num_mines and first_click_policy. Only the numbers of the board are replaced, display states (flags placed
+// before the first click) are kept. Returns false (board untouched) if nothing was found within time_limit seconds.
+// threads <= 0 means one per core, stats may be NULL.
+bool generateNoGuessMines(uint8_t *board, int start_x, int start_y, int threads, double time_limit, NoGuessStats *stats);
+
+#endif
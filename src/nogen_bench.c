@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "engine.h"
+#include "nogen.h"
+#include "platform.h"
+
+// minesweeper-nogen-bench [seconds] [threads] [width height mines]
+// Generates no-guess boards for each difficulty for a fixed time and reports throughput and acceptance rate
+int main(int argc, char **argv) {
+  const double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+  const int threads = argc > 2 ? atoi(argv[2]) : getCoreCount();
+  const int custom_width = argc > 5 ? atoi(argv[3]) : 30;
+  const int custom_height = argc > 5 ? atoi(argv[4]) : 30;
+  const int custom_mines = argc > 5 ? atoi(argv[5]) : 150;
+  if (seconds <= 0.0 || threads < 1 || custom_width < 1 || custom_height < 1 || custom_mines < 1) {
+    fprintf(stderr, "usage: minesweeper-nogen-bench [seconds] [threads] [width height mines]\n");
+    return 1;
+  }
+
+  const char *names[] = {"beginner", "intermediate", "expert", "custom"};
+  const int settings[] = {difficulty_nums[0], difficulty_nums[1], difficulty_nums[2], difficulty_nums[3], difficulty_nums[4],
+                          difficulty_nums[5], difficulty_nums[6], difficulty_nums[7], difficulty_nums[8], custom_width,
+                          custom_height,      custom_mines};
+
+  seedRandom((uint64_t)time(NULL));
+  printf("%d threads, %.1f s per difficulty\n", threads, seconds);
+  printf("%-13s %9s %8s %8s %12s %11s %12s\n", "difficulty", "size", "density", "boards", "candidates/s", "acceptance", "ms/board");
+  for (int i = 0; i < 4; ++i) {
+    board_width = settings[i * 3 + 0];
+    board_height = settings[i * 3 + 1];
+    num_mines = settings[i * 3 + 2];
+    if (num_mines > board_width * board_height - 1) {
+      num_mines = board_width * board_height - 1;
+    }
+    uint8_t *board = malloc(sizeof(uint8_t) * board_width * board_height);
+
+    NoGuessStats total = {0};
+    uint64_t boards = 0;
+    while (total.seconds < seconds) {
+      resetGame(board);
+      NoGuessStats stats;
+      boards += generateNoGuessMines(board, board_width / 2, board_height / 2, threads, seconds - total.seconds, &stats);
+      total.candidates += stats.candidates;
+      total.accepted += stats.accepted;
+      total.seconds += stats.seconds;
+    }
+
+    char size[32];
+    snprintf(size, sizeof(size), "%dx%d", board_width, board_height);
+    printf("%-13s %9s %7.1f%% %8llu %12.0f %10.2f%% %12.2f\n", names[i], size, 100.0 * num_mines / (board_width * board_height),
+           (unsigned long long)boards, total.candidates / total.seconds,
+           total.candidates > 0 ? 100.0 * total.accepted / total.candidates : 0.0, boards > 0 ? total.seconds * 1000.0 / boards : 0.0);
+    free(board);
+  }
+  return 0;
+}
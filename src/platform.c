@@ -0,0 +1,287 @@
+// fileno, ftruncate, fseeko, madvise and the DT_* entry types are POSIX/BSD extensions that a strict -std=c17 build hides.
+// Defined before the first include, which is platform.h (it pulls in stdio.h). _POSIX_C_SOURCE alone hides the BSD parts,
+// _DEFAULT_SOURCE (glibc) and _DARWIN_C_SOURCE (macOS) bring them back.
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+// 64-bit off_t for fseeko on 32-bit systems
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <io.h>
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Files at least this big are mapped instead of read
+#define MAP_THRESHOLD (256 * 1024)
+
+int getCoreCount(void) {
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  const int cores = (int)info.dwNumberOfProcessors;
+#else
+  const int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return cores > 0 ? cores : 1;
+}
+
+bool makeDirectory(const char *path) {
+#if defined(_WIN32)
+  return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+  return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+bool isDirectory(const char *path) {
+#if defined(_WIN32)
+  const DWORD attributes = GetFileAttributesA(path);
+  return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+  struct stat info;
+  return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+bool replaceFile(const char *from, const char *to) {
+#if defined(_WIN32)
+  return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return rename(from, to) == 0;
+#endif
+}
+
+bool syncFile(FILE *file) {
+  if (fflush(file) != 0) {
+    return false;
+  }
+#if defined(_WIN32)
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool seekFile(FILE *file, int64_t offset) {
+#if defined(_WIN32)
+  return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+  return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool walkDirectory(const char *path, void (*visit)(const char *path, void *user), void *user) {
+  const size_t path_length = strlen(path);
+  char *child = NULL;
+  size_t child_capacity = 0;
+#if defined(_WIN32)
+  char *pattern = malloc(path_length + 3);
+  snprintf(pattern, path_length + 3, "%s\\*", path);
+  WIN32_FIND_DATAA entry;
+  HANDLE find = FindFirstFileA(pattern, &entry);
+  free(pattern);
+  if (find == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  do {
+    const char *name = entry.cFileName;
+#else
+  DIR *dir = opendir(path);
+  if (!dir) {
+    return false;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir))) {
+    const char *name = entry->d_name;
+#endif
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+      continue;
+    }
+    const size_t length = path_length + 1 + strlen(name) + 1;
+    if (length > child_capacity) {
+      child_capacity = length * 2;
+      child = realloc(child, child_capacity);
+    }
+    snprintf(child, length, "%s/%s", path, name);
+#if defined(_WIN32)
+    const bool directory = entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
+    const bool regular = !directory && !(entry.dwFileAttributes & FILE_ATTRIBUTE_DEVICE);
+#else
+    // Most file systems fill in the type, saving a stat per file. Symlinked directories aren't followed.
+    bool directory = entry->d_type == DT_DIR;
+    bool regular = entry->d_type == DT_REG;
+    struct stat info;
+    if ((entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) && stat(child, &info) == 0) {
+      directory = entry->d_type == DT_UNKNOWN && S_ISDIR(info.st_mode);
+      regular = S_ISREG(info.st_mode);
+    }
+#endif
+    if (directory) {
+      walkDirectory(child, visit, user);
+    } else if (regular) {
+      visit(child, user);
+    }
+#if defined(_WIN32)
+  } while (FindNextFileA(find, &entry));
+  FindClose(find);
+#else
+  }
+  closedir(dir);
+#endif
+  free(child);
+  return true;
+}
+
+static bool growBuffer(uint8_t **buffer, size_t *buffer_capacity, size_t size) {
+  if (size <= *buffer_capacity) {
+    return true;
+  }
+  uint8_t *grown = realloc(*buffer, size);
+  if (!grown) {
+    return false;
+  }
+  *buffer = grown;
+  *buffer_capacity = size;
+  return true;
+}
+
+bool openFileView(const char *path, FileView *view, uint8_t **buffer, size_t *buffer_capacity) {
+  *view = (FileView){0};
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER file_size;
+  bool opened = GetFileSizeEx(file, &file_size) != 0;
+  const size_t size = opened ? (size_t)file_size.QuadPart : 0;
+  if (opened && size >= MAP_THRESHOLD) {
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    view->data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    view->mapped = view->data != NULL;
+    opened = view->mapped;
+  } else if (opened && growBuffer(buffer, buffer_capacity, size)) {
+    size_t done = 0;
+    DWORD read = 0;
+    while (done < size && ReadFile(file, *buffer + done, (DWORD)(size - done), &read, NULL) && read > 0) {
+      done += read;
+    }
+    view->data = *buffer;
+    opened = done == size;
+  } else {
+    opened = false;
+  }
+  CloseHandle(file);
+#else
+  const int file = open(path, O_RDONLY);
+  if (file < 0) {
+    return false;
+  }
+  struct stat info;
+  bool opened = fstat(file, &info) == 0;
+  const size_t size = opened ? (size_t)info.st_size : 0;
+  if (opened && size >= MAP_THRESHOLD) {
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+    opened = data != MAP_FAILED;
+    if (opened) {
+      madvise(data, size, MADV_SEQUENTIAL);
+      view->data = data;
+      view->mapped = true;
+    }
+  } else if (opened && growBuffer(buffer, buffer_capacity, size)) {
+    size_t done = 0;
+    ssize_t read_size = 0;
+    while (done < size && (read_size = read(file, *buffer + done, size - done)) > 0) {
+      done += (size_t)read_size;
+    }
+    view->data = *buffer;
+    opened = done == size;
+  } else {
+    opened = false;
+  }
+  close(file);
+#endif
+  view->size = size;
+  return opened;
+}
+
+void closeFileView(FileView *view) {
+  if (view->mapped) {
+#if defined(_WIN32)
+    UnmapViewOfFile(view->data);
+#else
+    munmap((void *)view->data, view->size);
+#endif
+  }
+  *view = (FileView){0};
+}
+
+bool mapScratchFile(const char *path, size_t size, FileMapping *mapping) {
+  *mapping = (FileMapping){0};
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  HANDLE section = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+  void *data = section ? MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0, 0) : NULL;
+  if (section) {
+    CloseHandle(section);
+  }
+  if (!data) {
+    CloseHandle(file);
+    return false;
+  }
+  mapping->handle = file;
+#else
+  const int file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (file < 0) {
+    return false;
+  }
+  // The mapping keeps the file alive, nothing is left behind if the process dies
+  unlink(path);
+  void *data = ftruncate(file, (off_t)size) == 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+  close(file);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+#endif
+  mapping->data = data;
+  mapping->size = size;
+  return true;
+}
+
+void unmapScratchFile(FileMapping *mapping) {
+  if (!mapping->data) {
+    return;
+  }
+#if defined(_WIN32)
+  UnmapViewOfFile(mapping->data);
+  CloseHandle(mapping->handle);
+#else
+  munmap(mapping->data, mapping->size);
+#endif
+  *mapping = (FileMapping){0};
+}
@@ -0,0 +1,48 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Number of logical cores, at least 1
+int getCoreCount(void);
+
+// Creates the directory if it doesn't exist yet, false if it couldn't
+bool makeDirectory(const char *path);
+bool isDirectory(const char *path);
+// Renames from over to, replacing it if it exists
+bool replaceFile(const char *from, const char *to);
+
+// Flushes the stream and has the OS write the file to disk
+bool syncFile(FILE *file);
+// fseek from the start of the file with a 64-bit offset, long is 32 bits on Windows
+bool seekFile(FILE *file, int64_t offset);
+
+// Calls visit with every regular file under the directory, recursing into subdirectories. false if it can't be opened.
+bool walkDirectory(const char *path, void (*visit)(const char *path, void *user), void *user);
+
+// A whole file's contents. Large files are mapped, small ones are read into the caller's buffer (grown as needed and kept
+// for the next file): mapping a small file costs more in page faults and in the TLB flush on unmapping than the copy.
+typedef struct FileView {
+  const uint8_t *data;
+  size_t size;
+  bool mapped;
+} FileView;
+
+bool openFileView(const char *path, FileView *view, uint8_t **buffer, size_t *buffer_capacity);
+void closeFileView(FileView *view);
+
+// Zeroed read-write memory backed by a file that is deleted when it is unmapped. Its pages are written back to the file and
+// dropped under memory pressure instead of going to swap, so only the parts in use take up RAM.
+typedef struct FileMapping {
+  uint8_t *data;
+  size_t size;
+  void *handle;
+} FileMapping;
+
+bool mapScratchFile(const char *path, size_t size, FileMapping *mapping);
+void unmapScratchFile(FileMapping *mapping);
+
+#endif
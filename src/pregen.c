@@ -0,0 +1,239 @@
+#include "pregen.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "engine.h"
+#include "memtrack.h"
+#include "nogen.h"
+#include "trace.h"
+
+#define PREGEN_HOVER_SLOTS 4
+
+typedef struct PregenPool {
+  mtx_t lock;
+  cnd_t wake;
+  thrd_t thread;
+  bool running;
+  uint64_t seed;
+
+  int width;
+  int height;
+  int mines;
+  bool no_guess;
+  FirstClickPolicy policy;
+  uint32_t generation; // bumped on every configure so layouts in flight for old settings are thrown away
+
+  int capacity;
+  int32_t *slot_start; // start cell per slot, -1 when empty
+  uint8_t *slot_ready;
+  uint8_t *slot_seeded; // the layout came from slot_ids, no-guess layouts don't
+  uint8_t *slot_policy; // first click policy the layout was generated under
+  BoardId *slot_ids;
+  uint8_t *layouts; // capacity * cells
+  int next_victim;
+  int hover;
+} PregenPool;
+
+static PregenPool pool = {0};
+
+static bool isTable(void) { return pool.width * pool.height <= PREGEN_MAX_TABLE_CELLS; }
+
+static int findSlot(int start) {
+  if (isTable()) {
+    return start;
+  }
+  for (int i = 0; i < pool.capacity; ++i) {
+    if (pool.slot_start[i] == start) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static bool isReady(int start) {
+  const int slot = findSlot(start);
+  return slot >= 0 && pool.slot_ready[slot];
+}
+
+// Hovered cell first, then (small boards only) every other start cell
+static int pickJob(void) {
+  if (pool.capacity == 0) {
+    return -1;
+  }
+  if (pool.hover >= 0 && !isReady(pool.hover)) {
+    return pool.hover;
+  }
+  if (isTable()) {
+    for (int cell = 0; cell < pool.capacity; ++cell) {
+      if (!pool.slot_ready[cell]) {
+        return cell;
+      }
+    }
+  }
+  return -1;
+}
+
+static void storeLayout(int start, const uint8_t *layout, const BoardId *id, FirstClickPolicy policy) {
+  const int cells = pool.width * pool.height;
+  int slot = findSlot(start);
+  if (slot < 0) {
+    // Never evict the layout for the cell the cursor is on
+    slot = pool.next_victim;
+    if (pool.slot_start[slot] == pool.hover && pool.capacity > 1) {
+      slot = (slot + 1) % pool.capacity;
+    }
+    pool.next_victim = (slot + 1) % pool.capacity;
+    pool.slot_start[slot] = start;
+  }
+  memcpy(pool.layouts + (int64_t)slot * cells, layout, sizeof(uint8_t) * cells);
+  pool.slot_ready[slot] = true;
+  pool.slot_seeded[slot] = id != NULL;
+  pool.slot_ids[slot] = id ? *id : (BoardId){0};
+  pool.slot_policy[slot] = (uint8_t)policy;
+}
+
+static int pregenWorker(void *arg) {
+  TRACE_THREAD_NAME("pregen");
+  seedRandom(pool.seed);
+  uint8_t *scratch = NULL;
+  int scratch_cells = 0;
+
+  mtx_lock(&pool.lock);
+  while (pool.running) {
+    const int start = pickJob();
+    if (start < 0) {
+      cnd_wait(&pool.wake, &pool.lock);
+      continue;
+    }
+    const uint32_t generation = pool.generation;
+    board_width = pool.width;
+    board_height = pool.height;
+    num_mines = pool.mines;
+    first_click_policy = pool.policy;
+    const bool no_guess_layout = pool.no_guess;
+    mtx_unlock(&pool.lock);
+
+    const int cells = board_width * board_height;
+    if (cells > scratch_cells) {
+      scratch_cells = cells;
+      scratch = memRealloc(MEM_GENERATION, scratch, sizeof(uint8_t) * scratch_cells);
+    }
+    const int start_x = start % board_width;
+    const int start_y = start / board_width;
+    resetGame(scratch);
+    const BoardId id = {GENERATOR_VERSION, nextRandom(), board_width, board_height, num_mines, start, first_click_policy};
+    const bool seeded = !no_guess_layout || !generateNoGuessMines(scratch, start_x, start_y, 0, NO_GUESS_TIME_LIMIT, NULL);
+    if (seeded) {
+      generateSeededMines(scratch, &id);
+    }
+
+    mtx_lock(&pool.lock);
+    if (generation == pool.generation) {
+      storeLayout(start, scratch, seeded ? &id : NULL, first_click_policy);
+    }
+  }
+  mtx_unlock(&pool.lock);
+
+  freeEngineScratch();
+  memFree(scratch);
+  return 0;
+}
+
+void pregenStart(void) {
+  mtx_init(&pool.lock, mtx_plain);
+  cnd_init(&pool.wake);
+  pool.seed = nextRandom();
+  pool.hover = -1;
+  // The worker checks running under the lock, so it only looks once creation is known to have worked. Without the
+  // worker nothing is ever ready and every first click generates its own layout.
+  mtx_lock(&pool.lock);
+  pool.running = thrd_create(&pool.thread, pregenWorker, NULL) == thrd_success;
+  mtx_unlock(&pool.lock);
+}
+
+void pregenStop(void) {
+  mtx_lock(&pool.lock);
+  const bool running = pool.running;
+  pool.running = false;
+  cnd_signal(&pool.wake);
+  mtx_unlock(&pool.lock);
+  if (running) {
+    thrd_join(pool.thread, NULL);
+  }
+
+  cnd_destroy(&pool.wake);
+  mtx_destroy(&pool.lock);
+  memFree(pool.slot_start);
+  memFree(pool.slot_ready);
+  memFree(pool.slot_seeded);
+  memFree(pool.slot_policy);
+  memFree(pool.slot_ids);
+  memFree(pool.layouts);
+  pool = (PregenPool){0};
+}
+
+void pregenConfigure(int width, int height, int mines, bool no_guess) {
+  mtx_lock(&pool.lock);
+  if (width != pool.width || height != pool.height || mines != pool.mines || no_guess != pool.no_guess ||
+      first_click_policy != pool.policy) {
+    pool.width = width;
+    pool.height = height;
+    pool.mines = mines;
+    pool.no_guess = no_guess;
+    pool.policy = first_click_policy;
+    ++pool.generation;
+    pool.capacity = isTable() ? width * height : PREGEN_HOVER_SLOTS;
+    pool.slot_start = memRealloc(MEM_GENERATION, pool.slot_start, sizeof(int32_t) * pool.capacity);
+    pool.slot_ready = memRealloc(MEM_GENERATION, pool.slot_ready, sizeof(uint8_t) * pool.capacity);
+    pool.slot_seeded = memRealloc(MEM_GENERATION, pool.slot_seeded, sizeof(uint8_t) * pool.capacity);
+    pool.slot_policy = memRealloc(MEM_GENERATION, pool.slot_policy, sizeof(uint8_t) * pool.capacity);
+    pool.slot_ids = memRealloc(MEM_GENERATION, pool.slot_ids, sizeof(BoardId) * pool.capacity);
+    pool.layouts = memRealloc(MEM_GENERATION, pool.layouts, sizeof(uint8_t) * pool.capacity * width * height);
+    for (int i = 0; i < pool.capacity; ++i) {
+      pool.slot_start[i] = isTable() ? i : -1;
+      pool.slot_ready[i] = false;
+    }
+    pool.next_victim = 0;
+    pool.hover = -1;
+    cnd_signal(&pool.wake);
+  }
+  mtx_unlock(&pool.lock);
+}
+
+void pregenHover(int start_x, int start_y) {
+  mtx_lock(&pool.lock);
+  const int hover = start_x < 0 ? -1 : start_y * pool.width + start_x;
+  if (hover != pool.hover) {
+    pool.hover = hover;
+    cnd_signal(&pool.wake);
+  }
+  mtx_unlock(&pool.lock);
+}
+
+bool pregenTake(uint8_t *board, int start_x, int start_y) {
+  bool taken = false;
+  mtx_lock(&pool.lock);
+  if (pool.width == board_width && pool.height == board_height && pool.mines == num_mines && pool.no_guess == no_guess) {
+    const int slot = findSlot(start_y * board_width + start_x);
+    // A layout made under another first click policy could put a mine where this one promises a safe start
+    if (slot >= 0 && pool.slot_ready[slot] && pool.slot_policy[slot] == first_click_policy) {
+      const uint8_t *layout = pool.layouts + (int64_t)slot * board_width * board_height;
+      for (int i = 0; i < board_width * board_height; ++i) {
+        board[i] = setDisplayState(getNumber(layout[i]), getDisplayState(board[i]));
+      }
+      board_seeded = pool.slot_seeded[slot];
+      board_id = pool.slot_ids[slot];
+      // Used up, the next game gets a fresh one
+      pool.slot_ready[slot] = false;
+      cnd_signal(&pool.wake);
+      taken = true;
+    }
+  }
+  mtx_unlock(&pool.lock);
+  if (taken) {
+    ++board_revision;
+  }
+  return taken;
+}
@@ -0,0 +1,22 @@
+#ifndef PREGEN_H
+#define PREGEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Background worker that generates layouts before the first click needs them. On boards of up to PREGEN_MAX_TABLE_CELLS
+// cells it keeps one layout per possible start cell, on larger boards it generates for the cell under the cursor.
+#define PREGEN_MAX_TABLE_CELLS 512
+
+void pregenStart(void);
+void pregenStop(void);
+// Settings of the next game, together with the calling thread's first_click_policy. Drops every layout made for the
+// previous ones.
+void pregenConfigure(int width, int height, int mines, bool no_guess);
+// Cell under the cursor before the first click, generated next. -1 when not over the board.
+void pregenHover(int start_x, int start_y);
+// Copies a ready layout for this start cell into the board's numbers (display states are kept) and sets board_seeded and
+// board_id to its identity, false if there isn't one
+bool pregenTake(uint8_t *board, int start_x, int start_y);
+
+#endif
@@ -0,0 +1,534 @@
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codec.h"
+#include "engine.h"
+#include "iowriter.h"
+#include "memtrack.h"
+#include "timing.h"
+
+static const char replay_magic[3] = {'M', 'S', 'R'};
+
+thread_local ReplayWriter *replay_recorder = NULL;
+
+void replayWriterReserve(ReplayWriter *writer, size_t capacity) {
+  if (capacity > writer->buffer.size) {
+    bufferReserve(&writer->buffer, MEM_REPLAY, capacity - writer->buffer.size);
+  }
+}
+
+// The recording buffer is kept across games and doubles when it grows, only recordings longer than the reserve get there.
+// Exempt from the hot path checks like the solver's growth.
+static void reserveRecording(ReplayWriter *writer, size_t extra) {
+  const bool hot = memSetHotPath(false);
+  bufferReserve(&writer->buffer, MEM_REPLAY, extra);
+  memSetHotPath(hot);
+}
+
+static void putSeed(ByteBuffer *buffer, uint64_t seed) {
+  for (int i = 0; i < 8; ++i) {
+    buffer->data[buffer->size++] = (uint8_t)(seed >> (8 * i));
+  }
+}
+
+static uint64_t getSeed(ByteReader *reader) {
+  if (reader->failed || reader->size - reader->offset < 8) {
+    reader->failed = true;
+    return 0;
+  }
+  uint64_t seed = 0;
+  for (int i = 0; i < 8; ++i) {
+    seed |= (uint64_t)reader->data[reader->offset++] << (8 * i);
+  }
+  return seed;
+}
+
+void replayWriterBegin(ReplayWriter *writer, const uint8_t *board, int width, int height, int flags, int first_click,
+                       const BoardId *id) {
+  const int cells = width * height;
+  int mines = 0;
+  int flagged = 0;
+  for (int i = 0; i < cells; ++i) {
+    mines += getNumber(board[i]) == 9;
+    flagged += getDisplayState(board[i]) == cell_display_state_flagged;
+  }
+  ByteBuffer *buffer = &writer->buffer;
+  buffer->size = 0;
+  reserveRecording(writer, sizeof(replay_magic) + 1 + 8 * 10 + 8 + (id ? 0 : (size_t)mines * 5) + (size_t)flagged * 5);
+  memcpy(buffer->data, replay_magic, sizeof(replay_magic));
+  buffer->size = sizeof(replay_magic);
+  buffer->data[buffer->size++] = REPLAY_VERSION;
+  putVarint(buffer, width);
+  putVarint(buffer, height);
+  putVarint(buffer, mines);
+  putVarint(buffer, flags | (id ? REPLAY_FLAG_SEEDED : 0));
+  putVarint(buffer, first_click);
+  if (id) {
+    putVarint(buffer, id->generator_version);
+    putVarint(buffer, id->policy);
+    putSeed(buffer, id->seed);
+  } else {
+    int previous = -1;
+    for (int i = 0; i < cells; ++i) {
+      if (getNumber(board[i]) == 9) {
+        putVarint(buffer, i - previous - 1);
+        previous = i;
+      }
+    }
+  }
+  putVarint(buffer, flagged);
+  int previous = -1;
+  for (int i = 0; i < cells; ++i) {
+    if (getDisplayState(board[i]) == cell_display_state_flagged) {
+      putVarint(buffer, i - previous - 1);
+      previous = i;
+    }
+  }
+  writer->started = true;
+  writer->start_ns = getNanoseconds();
+  writer->last_time_ms = 0;
+  writer->last_cell = first_click;
+}
+
+void replayWriterEvent(ReplayWriter *writer, ReplayEventKind kind, int cell) {
+  if (!writer->started) {
+    return;
+  }
+  const uint32_t time_ms = (uint32_t)((getNanoseconds() - writer->start_ns) / 1000000u);
+  reserveRecording(writer, 20);
+  putVarint(&writer->buffer, ((uint64_t)(time_ms - writer->last_time_ms) << 2) | kind);
+  putVarint(&writer->buffer, zigzag((int64_t)cell - writer->last_cell));
+  writer->last_time_ms = time_ms;
+  writer->last_cell = cell;
+}
+
+bool replayWriterSave(const ReplayWriter *writer, const char *path) {
+  return ioWrite(path, IO_CREATE, IO_SYNC_NONE, 0, writer->buffer.data, writer->buffer.size);
+}
+
+void replayWriterReset(ReplayWriter *writer) {
+  writer->buffer.size = 0;
+  writer->started = false;
+}
+
+void replayWriterFree(ReplayWriter *writer) {
+  memFree(writer->buffer.data);
+  *writer = (ReplayWriter){0};
+}
+
+// Mines of a seeded layout, generated on a scratch board with the engine's board size and layout identity put back after
+static void regenerateMines(Replay *replay) {
+  const int saved_width = board_width;
+  const int saved_height = board_height;
+  const int saved_mines = num_mines;
+  const bool saved_seeded = board_seeded;
+  const BoardId saved_id = board_id;
+  board_width = replay->width;
+  board_height = replay->height;
+  num_mines = replay->mines;
+  const int cells = replay->width * replay->height;
+  uint8_t *scratch = memCalloc(MEM_REPLAY, cells, sizeof(uint8_t));
+  generateSeededMines(scratch, &replay->id);
+  int mines = 0;
+  for (int i = 0; i < cells; ++i) {
+    if (getNumber(scratch[i]) == 9) {
+      replay->mine_cells[mines++] = i;
+    }
+  }
+  memFree(scratch);
+  board_width = saved_width;
+  board_height = saved_height;
+  num_mines = saved_mines;
+  board_seeded = saved_seeded;
+  board_id = saved_id;
+}
+
+// count cells stored as gaps, false if they run past the board
+static bool getCellGaps(ByteReader *reader, int32_t *cells, uint64_t count, int64_t board_cells) {
+  int64_t cell = -1;
+  for (uint64_t i = 0; i < count; ++i) {
+    cell += (int64_t)getVarint(reader) + 1;
+    if (reader->failed || cell >= board_cells) {
+      return false;
+    }
+    cells[i] = (int32_t)cell;
+  }
+  return true;
+}
+
+// Mine counts generateMines can place around a first click with the policy
+static bool validLayout(uint64_t cells, uint64_t mines, uint64_t first_click, uint64_t policy) {
+  return policy <= FIRST_CLICK_ANY && first_click < cells && mines <= cells - (policy != FIRST_CLICK_ANY);
+}
+
+bool replayDecode(const uint8_t *data, size_t size, Replay *replay) {
+  *replay = (Replay){0};
+  if (size < sizeof(replay_magic) + 1 || memcmp(data, replay_magic, sizeof(replay_magic)) != 0 || data[sizeof(replay_magic)] < 1 ||
+      data[sizeof(replay_magic)] > REPLAY_VERSION) {
+    return false;
+  }
+  const uint8_t version = data[sizeof(replay_magic)];
+  ByteReader reader = {data, size, sizeof(replay_magic) + 1, false};
+  const uint64_t width = getVarint(&reader);
+  const uint64_t height = getVarint(&reader);
+  const uint64_t mines = getVarint(&reader);
+  replay->flags = (int)getVarint(&reader);
+  const uint64_t first_click = getVarint(&reader);
+  if (reader.failed || width == 0 || height == 0 || width > INT32_MAX / height || mines > width * height ||
+      first_click >= width * height) {
+    return false;
+  }
+  replay->width = (int)width;
+  replay->height = (int)height;
+  replay->mines = (int)mines;
+  replay->first_click = (int32_t)first_click;
+
+  const int64_t cells = (int64_t)width * height;
+  replay->mine_cells = malloc(sizeof(int32_t) * (mines > 0 ? mines : 1));
+  if (replay->flags & REPLAY_FLAG_SEEDED) {
+    const uint64_t generator_version = getVarint(&reader);
+    const uint64_t policy = getVarint(&reader);
+    const uint64_t seed = getSeed(&reader);
+    if (reader.failed || generator_version != GENERATOR_VERSION || !validLayout(cells, mines, first_click, policy)) {
+      if (!reader.failed && generator_version != GENERATOR_VERSION) {
+        fprintf(stderr, "replay: layout from generator version %llu, this build has %d\n", (unsigned long long)generator_version,
+                GENERATOR_VERSION);
+      }
+      replayFree(replay);
+      return false;
+    }
+    replay->seeded = true;
+    replay->id =
+        (BoardId){GENERATOR_VERSION, seed, replay->width, replay->height, replay->mines, replay->first_click, (FirstClickPolicy)policy};
+    regenerateMines(replay);
+  } else if (!getCellGaps(&reader, replay->mine_cells, mines, cells)) {
+    replayFree(replay);
+    return false;
+  }
+  const uint64_t flagged = version >= 3 ? getVarint(&reader) : 0;
+  if (reader.failed || flagged > (uint64_t)cells) {
+    replayFree(replay);
+    return false;
+  }
+  replay->num_flag_cells = (int)flagged;
+  replay->flag_cells = malloc(sizeof(int32_t) * (flagged > 0 ? flagged : 1));
+  if (!getCellGaps(&reader, replay->flag_cells, flagged, cells)) {
+    replayFree(replay);
+    return false;
+  }
+
+  int capacity = 64;
+  replay->events = malloc(sizeof(ReplayEvent) * capacity);
+  uint64_t time_ms = 0;
+  int64_t last_cell = replay->first_click;
+  while (reader.offset < reader.size) {
+    const uint64_t tag = getVarint(&reader);
+    const int64_t event_cell = last_cell + unzigzag(getVarint(&reader));
+    // Only a press can be on no cell
+    if (reader.failed || event_cell < ((tag & 3) == REPLAY_PRESS ? -1 : 0) || event_cell >= cells) {
+      replayFree(replay);
+      return false;
+    }
+    time_ms += tag >> 2;
+    if (replay->num_events == capacity) {
+      capacity *= 2;
+      replay->events = realloc(replay->events, sizeof(ReplayEvent) * capacity);
+    }
+    replay->events[replay->num_events++] = (ReplayEvent){(ReplayEventKind)(tag & 3), (int32_t)event_cell, (uint32_t)time_ms};
+    last_cell = event_cell;
+  }
+  return true;
+}
+
+bool replayLoad(const char *path, Replay *replay) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "replay: cannot read %s\n", path);
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *data = malloc(size > 0 ? size : 1);
+  const bool read = size > 0 && fread(data, 1, size, file) == (size_t)size;
+  fclose(file);
+  const bool decoded = read && replayDecode(data, size, replay);
+  free(data);
+  if (!decoded) {
+    fprintf(stderr, "replay: %s is not a replay\n", path);
+  }
+  return decoded;
+}
+
+void replayFree(Replay *replay) {
+  free(replay->mine_cells);
+  free(replay->flag_cells);
+  free(replay->events);
+  *replay = (Replay){0};
+}
+
+// A keyframe every this many events, or sooner once an eighth of the board was opened since the last one. Large boards get
+// fewer, restoring one there costs as much as replaying a few thousand events.
+#define KEYFRAME_INTERVAL 256
+
+static int keyframeInterval(int cells) { return cells / 256 > KEYFRAME_INTERVAL ? cells / 256 : KEYFRAME_INTERVAL; }
+
+static void addKeyframe(ReplayPlayer *player) {
+  if (player->num_keyframes == player->keyframe_capacity) {
+    player->keyframe_capacity = player->keyframe_capacity ? player->keyframe_capacity * 2 : 16;
+    player->keyframes = memRealloc(MEM_REPLAY, player->keyframes, sizeof(ReplayKeyframe) * player->keyframe_capacity);
+  }
+  player->keyframes[player->num_keyframes++] =
+      (ReplayKeyframe){player->position, player->keyframe_data.size, mines_left, opened_cells, game_over, game_won, player->pressed_cell};
+  putDisplayStates(&player->keyframe_data, MEM_REPLAY, player->board, board_width * board_height);
+}
+
+static void restoreKeyframe(ReplayPlayer *player, const ReplayKeyframe *keyframe) {
+  ByteReader reader = {player->keyframe_data.data, player->keyframe_data.size, keyframe->offset, false};
+  getDisplayStates(&reader, player->board, board_width * board_height);
+  player->position = keyframe->position;
+  player->pressed_cell = keyframe->pressed_cell;
+  mines_left = keyframe->mines_left;
+  opened_cells = keyframe->opened_cells;
+  game_over = keyframe->game_over;
+  game_won = keyframe->game_won;
+  game_running = !game_over;
+  timer_running = false;
+  ++board_revision;
+}
+
+// Presses only matter to the viewer
+static void applyMove(uint8_t *board, ReplayEvent event) {
+  const int x = event.cell % board_width;
+  const int y = event.cell / board_width;
+  switch (event.kind) {
+  case REPLAY_OPEN:
+    playOpen(board, x, y);
+    break;
+  case REPLAY_CHORD:
+    playChord(board, x, y);
+    break;
+  case REPLAY_FLAG:
+    playFlag(board, x, y);
+    break;
+  case REPLAY_PRESS:
+    break;
+  }
+}
+
+static void applyEvent(ReplayPlayer *player, ReplayEvent event) {
+  if (event.kind == REPLAY_PRESS) {
+    player->pressed_cell = event.cell;
+  } else {
+    applyMove(player->board, event);
+  }
+}
+
+// Lays out the mines and the flags placed before the first click, then plays it. The caller detaches the recorder.
+static void startReplay(const Replay *replay, uint8_t *board) {
+  board_width = replay->width;
+  board_height = replay->height;
+  num_mines = replay->mines;
+  resetGame(board);
+  for (int i = 0; i < replay->mines; ++i) {
+    board[replay->mine_cells[i]] = 9;
+  }
+  computeNumbers(board);
+  for (int i = 0; i < replay->num_flag_cells; ++i) {
+    toggleFlagged(board, replay->flag_cells[i] % board_width, replay->flag_cells[i] / board_width);
+  }
+  is_first_open = false;
+  playOpen(board, replay->first_click % board_width, replay->first_click / board_width);
+}
+
+void replayPlay(const Replay *replay, uint8_t *board) {
+  ReplayWriter *recorder = replay_recorder;
+  replay_recorder = NULL;
+  startReplay(replay, board);
+  for (int i = 0; i < replay->num_events; ++i) {
+    applyMove(board, replay->events[i]);
+  }
+  replay_recorder = recorder;
+}
+
+void replayPlayerInit(ReplayPlayer *player, Replay *replay, uint8_t *board) {
+  *player = (ReplayPlayer){0};
+  player->replay = *replay;
+  *replay = (Replay){0};
+  player->board = board;
+  player->pressed_cell = -1;
+  ReplayWriter *recorder = replay_recorder;
+  replay_recorder = NULL;
+
+  startReplay(&player->replay, board);
+  addKeyframe(player);
+
+  const int cells = board_width * board_height;
+  const int interval = keyframeInterval(cells);
+  for (int i = 0; i < player->replay.num_events; ++i) {
+    applyEvent(player, player->replay.events[i]);
+    player->position = i + 1;
+    const ReplayKeyframe *last = &player->keyframes[player->num_keyframes - 1];
+    if (player->position - last->position >= interval || opened_cells - last->opened_cells >= cells / 8) {
+      addKeyframe(player);
+    }
+  }
+  replay_recorder = recorder;
+  replayPlayerSeek(player, 0);
+}
+
+void replayPlayerSeek(ReplayPlayer *player, int position) {
+  position = position < 0 ? 0 : (position > player->replay.num_events ? player->replay.num_events : position);
+  int low = 0;
+  int high = player->num_keyframes - 1;
+  while (low < high) {
+    const int middle = (low + high + 1) / 2;
+    if (player->keyframes[middle].position <= position) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+  // Going forward within the same keyframe interval only needs the events in between
+  if (position < player->position || player->keyframes[low].position > player->position) {
+    restoreKeyframe(player, &player->keyframes[low]);
+  }
+  ReplayWriter *recorder = replay_recorder;
+  replay_recorder = NULL;
+  for (; player->position < position; ++player->position) {
+    applyEvent(player, player->replay.events[player->position]);
+  }
+  replay_recorder = recorder;
+}
+
+int replayPlayerPositionAt(const ReplayPlayer *player, uint32_t time_ms) {
+  int low = 0;
+  int high = player->replay.num_events;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (player->replay.events[middle].time_ms <= time_ms) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+uint32_t replayPlayerDuration(const ReplayPlayer *player) {
+  return player->replay.num_events > 0 ? player->replay.events[player->replay.num_events - 1].time_ms : 0;
+}
+
+void replayPlayerFree(ReplayPlayer *player) {
+  replayFree(&player->replay);
+  memFree(player->keyframes);
+  memFree(player->keyframe_data.data);
+  *player = (ReplayPlayer){0};
+}
+
+static const char share_code_digits[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+
+// FNV-1a folded to a byte
+static uint8_t shareCodeCheck(const uint8_t *data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return (uint8_t)(hash ^ (hash >> 8) ^ (hash >> 16) ^ (hash >> 24));
+}
+
+void shareCodeEncode(const BoardId *id, char code[SHARE_CODE_MAX]) {
+  uint8_t bytes[6 * 10 + 8 + 1];
+  ByteBuffer buffer = {bytes, 0, sizeof(bytes)};
+  putVarint(&buffer, id->generator_version);
+  putVarint(&buffer, id->policy);
+  putVarint(&buffer, (uint32_t)id->width);
+  putVarint(&buffer, (uint32_t)id->height);
+  putVarint(&buffer, (uint32_t)id->mines);
+  putVarint(&buffer, (uint32_t)id->first_click);
+  putSeed(&buffer, id->seed);
+  bytes[buffer.size] = shareCodeCheck(bytes, buffer.size);
+  ++buffer.size;
+
+  int length = 0;
+  code[length++] = 'M';
+  code[length++] = 'S';
+  uint32_t bits = 0;
+  int count = 0;
+  for (size_t i = 0; i < buffer.size; ++i) {
+    bits = bits << 8 | bytes[i];
+    count += 8;
+    while (count >= 5) {
+      count -= 5;
+      code[length++] = share_code_digits[(bits >> count) & 31];
+    }
+  }
+  if (count > 0) {
+    code[length++] = share_code_digits[(bits << (5 - count)) & 31];
+  }
+  code[length] = '\0';
+}
+
+// Crockford's alphabet leaves out I, L, O and U, the first three are read as the digits they look like
+static int shareCodeDigit(char c) {
+  c = (char)(c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
+  c = c == 'O' ? '0' : (c == 'I' || c == 'L') ? '1' : c;
+  const char *digit = c ? strchr(share_code_digits, c) : NULL;
+  return digit ? (int)(digit - share_code_digits) : -1;
+}
+
+bool shareCodeDecode(const char *code, BoardId *id) {
+  while (*code == ' ' || *code == '\t' || *code == '\n' || *code == '\r') {
+    ++code;
+  }
+  if ((code[0] != 'M' && code[0] != 'm') || (code[1] != 'S' && code[1] != 's')) {
+    return false;
+  }
+  uint8_t bytes[6 * 10 + 8 + 1];
+  size_t size = 0;
+  uint32_t bits = 0;
+  int count = 0;
+  for (const char *c = code + 2; *c; ++c) {
+    if (*c == '-' || *c == ' ' || *c == '\t' || *c == '\n' || *c == '\r') {
+      continue;
+    }
+    const int digit = shareCodeDigit(*c);
+    if (digit < 0) {
+      return false;
+    }
+    bits = bits << 5 | (uint32_t)digit;
+    count += 5;
+    if (count >= 8) {
+      count -= 8;
+      if (size == sizeof(bytes)) {
+        return false;
+      }
+      bytes[size++] = (uint8_t)(bits >> count);
+    }
+  }
+  if (size < 2 || shareCodeCheck(bytes, size - 1) != bytes[size - 1]) {
+    return false;
+  }
+  ByteReader reader = {bytes, size - 1, 0, false};
+  const uint64_t generator_version = getVarint(&reader);
+  const uint64_t policy = getVarint(&reader);
+  const uint64_t width = getVarint(&reader);
+  const uint64_t height = getVarint(&reader);
+  const uint64_t mines = getVarint(&reader);
+  const uint64_t first_click = getVarint(&reader);
+  const uint64_t seed = getSeed(&reader);
+  if (reader.failed || reader.offset != reader.size || width == 0 || height == 0 || width > INT32_MAX / height ||
+      !validLayout(width * height, mines, first_click, policy)) {
+    return false;
+  }
+  if (generator_version != GENERATOR_VERSION) {
+    fprintf(stderr, "replay: share code from generator version %llu, this build has %d\n", (unsigned long long)generator_version,
+            GENERATOR_VERSION);
+    return false;
+  }
+  *id = (BoardId){GENERATOR_VERSION, seed, (int32_t)width, (int32_t)height, (int32_t)mines, (int32_t)first_click, (FirstClickPolicy)policy};
+  return true;
+}
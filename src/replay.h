@@ -0,0 +1,133 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "codec.h"
+#include "engine.h"
+#include "threadlocal.h"
+
+// Compact game replays. The header holds the board size and the layout, as its seed when it was generated from one
+// (BoardId) and otherwise as gaps between mine cells, then every move follows as varint(time delta in ms << 2 | kind)
+// and a zigzag varint of the cell minus the previous event's cell. An expert game is a few hundred bytes.
+//
+//   "MSR", version byte
+//   varint width, height, mines, flags, first click cell
+//   seeded: varint generator version, first click policy, then the seed as 8 little endian bytes
+//   otherwise mines varints: first mine cell, then the gap to each next one minus 1
+//   varint count of cells flagged before the first click, then their gaps like the mines
+//   events until the end of the file
+//
+// Flags placed before the first click are applied before it is played. Version 2 replays have no such count and recorded
+// those flags as events after the first click, version 1 ones are version 2 ones without seeds. Both still load. Seeded
+// replays only load with the generator version they were made with.
+
+#define REPLAY_VERSION 3
+#define REPLAY_FLAG_NO_GUESS 1
+#define REPLAY_FLAG_SEEDED 2
+
+typedef enum ReplayEventKind {
+  REPLAY_OPEN,
+  REPLAY_CHORD,
+  REPLAY_FLAG,
+  REPLAY_PRESS // cell shown pressed under the cursor, -1 once nothing is
+} ReplayEventKind;
+
+typedef struct ReplayEvent {
+  ReplayEventKind kind;
+  int32_t cell;
+  uint32_t time_ms; // since the first click
+} ReplayEvent;
+
+// Appends to one growing buffer, so recording a move only allocates when the buffer has to double
+typedef struct ReplayWriter {
+  ByteBuffer buffer;
+  bool started; // header written, set by the first open
+  uint64_t start_ns;
+  uint32_t last_time_ms;
+  int32_t last_cell;
+} ReplayWriter;
+
+typedef struct Replay {
+  int width;
+  int height;
+  int mines;
+  int flags;
+  int32_t first_click;
+  bool seeded; // the mines were regenerated from id
+  BoardId id;
+  int32_t *mine_cells;
+  int32_t *flag_cells; // flagged before the first click
+  int num_flag_cells;
+  ReplayEvent *events;
+  int num_events;
+} Replay;
+
+// Board state after a number of events, the display states are in the player's keyframe buffer (putDisplayStates)
+typedef struct ReplayKeyframe {
+  int position;
+  size_t offset;
+  int mines_left;
+  int opened_cells;
+  bool game_over;
+  bool game_won;
+  int32_t pressed_cell;
+} ReplayKeyframe;
+
+// Plays a replay back on a board. Keyframes are taken while the replay is loaded, so seeking restores the closest one
+// before the target and applies at most a keyframe interval of events through the engine.
+typedef struct ReplayPlayer {
+  Replay replay;
+  uint8_t *board; // the caller's, board_width * board_height
+  int position;   // events applied, the first click is always applied
+  int32_t pressed_cell;
+  ReplayKeyframe *keyframes;
+  int num_keyframes;
+  int keyframe_capacity;
+  ByteBuffer keyframe_data;
+} ReplayPlayer;
+
+// Moves made through playOpen/playChord/playFlag on this thread are recorded here while it is set
+extern thread_local ReplayWriter *replay_recorder;
+
+// Grows the buffer up front so recording doesn't allocate on the frame path
+void replayWriterReserve(ReplayWriter *writer, size_t capacity);
+// Writes the header, board holds the layout the first click at first_click is played on and any flags placed before it.
+// Called before the click opens anything. The layout is stored as id when it has one, NULL stores the mine cells.
+void replayWriterBegin(ReplayWriter *writer, const uint8_t *board, int width, int height, int flags, int first_click,
+                       const BoardId *id);
+void replayWriterEvent(ReplayWriter *writer, ReplayEventKind kind, int cell);
+bool replayWriterSave(const ReplayWriter *writer, const char *path);
+// Ready for the next game, the buffer is kept
+void replayWriterReset(ReplayWriter *writer);
+void replayWriterFree(ReplayWriter *writer);
+
+bool replayDecode(const uint8_t *data, size_t size, Replay *replay);
+bool replayLoad(const char *path, Replay *replay);
+void replayFree(Replay *replay);
+
+// Sets the engine's board size and plays the whole game on board (width * height cells), the outcome is left in
+// game_over and game_won
+void replayPlay(const Replay *replay, uint8_t *board);
+
+// Takes over the replay and sets the engine's board size and mine count, board must hold width * height cells
+void replayPlayerInit(ReplayPlayer *player, Replay *replay, uint8_t *board);
+// Shows the board after the first position events
+void replayPlayerSeek(ReplayPlayer *player, int position);
+// Number of events played by time_ms
+int replayPlayerPositionAt(const ReplayPlayer *player, uint32_t time_ms);
+uint32_t replayPlayerDuration(const ReplayPlayer *player);
+void replayPlayerFree(ReplayPlayer *player);
+
+// Share codes name a board by its BoardId in a few dozen characters: "MS", then Crockford base32 of the generator version,
+// policy, size, mines and first click as varints, the 8 seed bytes and a check byte. Case, dashes and spaces are ignored
+// when reading one back, a mistyped code fails the check instead of giving another board.
+#define SHARE_CODE_MAX 48
+
+void shareCodeEncode(const BoardId *id, char code[SHARE_CODE_MAX]);
+// false if it isn't a share code or was made by another generator version
+bool shareCodeDecode(const char *code, BoardId *id);
+
+#endif
@@ -0,0 +1,129 @@
+#include "savegame.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codec.h"
+#include "engine.h"
+#include "iowriter.h"
+#include "memtrack.h"
+#include "platform.h"
+
+static const char savegame_magic[3] = {'M', 'S', 'S'};
+
+bool saveGame(const char *path, const uint8_t *board, uint32_t elapsed_ms) {
+  const int cells = board_width * board_height;
+  const int flags = (no_guess ? SAVE_NO_GUESS : 0) | (is_first_open ? SAVE_FIRST_OPEN : 0) | (game_over ? SAVE_GAME_OVER : 0) |
+                    (game_won ? SAVE_GAME_WON : 0);
+  const int k = riceParameter(num_mines > 0 ? (double)(cells - num_mines) / num_mines : 0.0);
+
+  ByteBuffer buffer = {0};
+  bufferReserve(&buffer, MEM_BOARD, sizeof(savegame_magic) + 1 + 7 * 10);
+  memcpy(buffer.data, savegame_magic, sizeof(savegame_magic));
+  buffer.size = sizeof(savegame_magic);
+  buffer.data[buffer.size++] = SAVEGAME_VERSION;
+  putVarint(&buffer, board_width);
+  putVarint(&buffer, board_height);
+  putVarint(&buffer, num_mines);
+  putVarint(&buffer, zigzag(mines_left));
+  putVarint(&buffer, elapsed_ms);
+  putVarint(&buffer, flags);
+  putVarint(&buffer, k);
+  if (!is_first_open) {
+    BitWriter bits = {&buffer, MEM_BOARD, 0, 0};
+    int previous = -1;
+    for (int i = 0; i < cells; ++i) {
+      if (getNumber(board[i]) == 9) {
+        putRice(&bits, i - previous - 1, k);
+        previous = i;
+      }
+    }
+    flushBits(&bits);
+  }
+  putDisplayStates(&buffer, MEM_BOARD, board, cells);
+
+  const bool saved = ioWrite(path, IO_REPLACE, IO_SYNC_EACH, 0, buffer.data, buffer.size);
+  memFree(buffer.data);
+  return saved;
+}
+
+bool loadGame(const char *path, SavedGame *game) {
+  *game = (SavedGame){0};
+  uint8_t *data = NULL;
+  size_t capacity = 0;
+  FileView view;
+  if (!openFileView(path, &view, &data, &capacity)) {
+    free(data);
+    return false;
+  }
+  ByteReader reader = {view.data, view.size, sizeof(savegame_magic) + 1, false};
+  bool loaded = view.size >= sizeof(savegame_magic) + 1 && memcmp(view.data, savegame_magic, sizeof(savegame_magic)) == 0 &&
+                view.data[sizeof(savegame_magic)] == SAVEGAME_VERSION;
+  const uint64_t width = getVarint(&reader);
+  const uint64_t height = getVarint(&reader);
+  const uint64_t mines = getVarint(&reader);
+  game->mines_left = (int)unzigzag(getVarint(&reader));
+  game->elapsed_ms = (uint32_t)getVarint(&reader);
+  game->flags = (int)getVarint(&reader);
+  const int k = (int)getVarint(&reader);
+  loaded = loaded && !reader.failed && width > 0 && height > 0 && width <= INT32_MAX / height && mines < width * height && k <= 24;
+  if (loaded) {
+    game->width = (int)width;
+    game->height = (int)height;
+    game->mines = (int)mines;
+    const int cells = game->width * game->height;
+    game->board = memCalloc(MEM_BOARD, cells, sizeof(uint8_t));
+    if (!(game->flags & SAVE_FIRST_OPEN)) {
+      BitReader bits = {&reader, 0, 0};
+      int64_t cell = -1;
+      for (int i = 0; i < game->mines && loaded; ++i) {
+        cell += (int64_t)getRice(&bits, k) + 1;
+        loaded = !reader.failed && cell < cells;
+        if (loaded) {
+          game->board[cell] = 9;
+        }
+      }
+    }
+    getDisplayStates(&reader, game->board, cells);
+    loaded = loaded && !reader.failed;
+  }
+  closeFileView(&view);
+  free(data);
+  if (!loaded) {
+    fprintf(stderr, "savegame: %s is not a saved game\n", path);
+    savedGameFree(game);
+  }
+  return loaded;
+}
+
+void restoreGame(const SavedGame *game, uint8_t *board) {
+  const int cells = game->width * game->height;
+  memcpy(board, game->board, sizeof(uint8_t) * cells);
+  computeNumbers(board);
+  // A cell shown pressed under the cursor when the game was saved is closed
+  opened_cells = 0;
+  for (int i = 0; i < cells; ++i) {
+    const uint8_t state = getDisplayState(board[i]);
+    if (state == cell_display_state_press) {
+      board[i] = setDisplayState(board[i], cell_display_state_closed);
+    }
+    opened_cells += state == cell_display_state_open;
+  }
+  num_mines = game->mines;
+  mines_left = game->mines_left;
+  no_guess = game->flags & SAVE_NO_GUESS;
+  is_first_open = game->flags & SAVE_FIRST_OPEN;
+  game_over = game->flags & SAVE_GAME_OVER;
+  game_won = game->flags & SAVE_GAME_WON;
+  game_running = !game_over;
+  timer_running = false;
+  timer = game->elapsed_ms / 1000;
+  board_seeded = false;
+  ++board_revision;
+}
+
+void savedGameFree(SavedGame *game) {
+  memFree(game->board);
+  *game = (SavedGame){0};
+}
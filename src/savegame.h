@@ -0,0 +1,41 @@
+#ifndef SAVEGAME_H
+#define SAVEGAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Game in progress on disk. The mine bitplane is stored as Rice coded gaps between mines, the display states as runs
+// (putDisplayStates), numbers are recomputed on load. A 1000x1000 expert density game is about a tenth of its raw size.
+//
+//   "MSS", version byte
+//   varint width, height, mines, zigzag mines left, elapsed ms, flags, rice parameter
+//   rice coded mine gaps (none before the first open), padded to a byte
+//   display state runs
+
+#define SAVEGAME_VERSION 1
+
+typedef enum SaveFlags {
+  SAVE_NO_GUESS = 1,
+  SAVE_FIRST_OPEN = 2, // no mines placed yet
+  SAVE_GAME_OVER = 4,
+  SAVE_GAME_WON = 8
+} SaveFlags;
+
+typedef struct SavedGame {
+  int width;
+  int height;
+  int mines;
+  int mines_left;
+  uint32_t elapsed_ms;
+  int flags;
+  uint8_t *board;
+} SavedGame;
+
+// The engine's current game on board, written to a temporary file first so an interrupted save keeps the old one
+bool saveGame(const char *path, const uint8_t *board, uint32_t elapsed_ms);
+bool loadGame(const char *path, SavedGame *game);
+// Sets the engine state, board_width and board_height have to match the saved game already
+void restoreGame(const SavedGame *game, uint8_t *board);
+void savedGameFree(SavedGame *game);
+
+#endif
@@ -0,0 +1,296 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "bitslice.h"
+#include "bot.h"
+#include "engine.h"
+#include "platform.h"
+#include "timing.h"
+
+typedef struct SimWorker {
+  int width;
+  int height;
+  int mines;
+  FirstClickPolicy policy;
+  uint64_t games;
+  uint64_t seed;
+  // Written only by the worker, read by the main thread for progress and merged after join
+  atomic_uint_fast64_t games_done;
+  uint64_t wins;
+  uint64_t guesses;
+  uint64_t guessless_games; // games the bot never had to guess in
+  uint64_t moves;
+} SimWorker;
+
+static int simWorker(void *arg) {
+  SimWorker *worker = arg;
+  board_width = worker->width;
+  board_height = worker->height;
+  num_mines = worker->mines;
+  first_click_policy = worker->policy;
+  seedRandom(worker->seed);
+
+  uint8_t *board = malloc(sizeof(uint8_t) * worker->width * worker->height);
+  Bot bot = {0};
+  for (uint64_t game = 0; game < worker->games; ++game) {
+    resetGame(board);
+    botReset(&bot);
+    while (botStep(&bot, board, 0.0) == BOT_MOVED)
+      ;
+    worker->wins += game_won;
+    worker->guesses += bot.guesses;
+    worker->guessless_games += bot.guesses == 0;
+    worker->moves += bot.moves;
+    atomic_store_explicit(&worker->games_done, game + 1, memory_order_relaxed);
+  }
+  botFree(&bot);
+  free(board);
+  freeEngineScratch();
+  return 0;
+}
+
+// Wilson score interval for a binomial proportion
+static void wilsonInterval(uint64_t successes, uint64_t trials, double z, double *low, double *high) {
+  const double n = (double)trials;
+  const double p = successes / n;
+  const double denominator = 1.0 + z * z / n;
+  const double centre = (p + z * z / (2.0 * n)) / denominator;
+  const double margin = z * sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / denominator;
+  *low = centre - margin;
+  *high = centre + margin;
+}
+
+static void simulate(const char *name, int width, int height, int mines, FirstClickPolicy policy, uint64_t games, int threads) {
+  SimWorker *workers = calloc(threads, sizeof(SimWorker));
+  thrd_t *handles = malloc(sizeof(thrd_t) * threads);
+  bool *started = malloc(sizeof(bool) * threads);
+  const uint64_t start = getNanoseconds();
+  for (int i = 0; i < threads; ++i) {
+    workers[i].width = width;
+    workers[i].height = height;
+    workers[i].mines = mines;
+    workers[i].policy = policy;
+    workers[i].games = games / threads + ((uint64_t)i < games % threads);
+    // Independent stream per worker, drawn from the main thread's generator
+    workers[i].seed = nextRandom();
+    atomic_init(&workers[i].games_done, 0);
+    started[i] = thrd_create(&handles[i], simWorker, &workers[i]) == thrd_success;
+  }
+  // A worker that couldn't be started plays its share on this thread, with the thread's own engine state put back after
+  for (int i = 0; i < threads; ++i) {
+    if (!started[i]) {
+      EngineState state;
+      saveEngineState(&state);
+      simWorker(&workers[i]);
+      restoreEngineState(&state);
+    }
+  }
+
+  // Progress on stderr about once a second while the workers run, long simulations take minutes
+  uint64_t done = 0;
+  uint64_t last_report = start;
+  while (done < games) {
+    thrd_sleep(&(struct timespec){.tv_nsec = 10000000}, NULL);
+    done = 0;
+    for (int i = 0; i < threads; ++i) {
+      done += atomic_load_explicit(&workers[i].games_done, memory_order_relaxed);
+    }
+    const uint64_t now = getNanoseconds();
+    if (now - last_report >= 1000000000u) {
+      last_report = now;
+      fprintf(stderr, "\r%s: %llu/%llu games, %.0f games/s ", name, (unsigned long long)done, (unsigned long long)games,
+              done / ((now - start) * 1e-9));
+    }
+  }
+  if (last_report != start) {
+    fprintf(stderr, "\r\033[K");
+  }
+  for (int i = 0; i < threads; ++i) {
+    if (started[i]) {
+      thrd_join(handles[i], NULL);
+    }
+  }
+  const double seconds = (getNanoseconds() - start) * 1e-9;
+
+  uint64_t wins = 0;
+  uint64_t guesses = 0;
+  uint64_t guessless_games = 0;
+  uint64_t moves = 0;
+  for (int i = 0; i < threads; ++i) {
+    wins += workers[i].wins;
+    guesses += workers[i].guesses;
+    guessless_games += workers[i].guessless_games;
+    moves += workers[i].moves;
+  }
+  double low, high;
+  wilsonInterval(wins, games, 1.959964, &low, &high);
+
+  char size[32];
+  snprintf(size, sizeof(size), "%dx%d/%d", width, height, mines);
+  char interval[48];
+  snprintf(interval, sizeof(interval), "%.3f-%.3f%%", 100.0 * low, 100.0 * high);
+  printf("%-13s %11s %7.1f%% %12llu %8.3f%% %17s %8.3f %9.2f%% %8.1f %10.0f\n", name, size, 100.0 * mines / (width * height),
+         (unsigned long long)games, 100.0 * wins / games, interval, (double)guesses / games, 100.0 * guessless_games / games,
+         (double)moves / games, games / seconds);
+  fflush(stdout);
+
+  free(started);
+  free(handles);
+  free(workers);
+}
+
+// Plays 64 boards at once with the bitsliced kernel, then the same boards one at a time with the scalar engine. Every board
+// opens its cells in its own random order until it is won or hits a mine. Reports generation and board steps (one open on
+// one board) per second for both, and checks that the final boards are identical.
+static int runBitsliceBench(double seconds, int width, int height, int mines) {
+  board_width = width;
+  board_height = height;
+  num_mines = mines;
+  const int cells = width * height;
+
+  BitsliceBoards boards;
+  bitsliceInit(&boards, width, height);
+  uint8_t *board = malloc(sizeof(uint8_t) * cells);
+  uint8_t *lane_board = malloc(sizeof(uint8_t) * cells);
+  // Step-major: clicks[step * BITSLICE_LANES + lane], the first step is the start cell
+  int32_t *clicks = malloc(sizeof(int32_t) * cells * BITSLICE_LANES);
+  int32_t step_clicks[BITSLICE_LANES];
+  int steps[BITSLICE_LANES];
+
+  uint64_t batches = 0;
+  uint64_t board_steps = 0;
+  uint64_t generate_ns[2] = {0, 0}; // bitslice, scalar
+  uint64_t play_ns[2] = {0, 0};
+  uint64_t mismatches = 0;
+  while ((generate_ns[0] + generate_ns[1] + play_ns[0] + play_ns[1]) * 1e-9 < seconds) {
+    for (int lane = 0; lane < BITSLICE_LANES; ++lane) {
+      for (int i = 0; i < cells; ++i) {
+        const int j = randint(i + 1);
+        clicks[i * BITSLICE_LANES + lane] = clicks[j * BITSLICE_LANES + lane];
+        clicks[j * BITSLICE_LANES + lane] = i;
+      }
+    }
+    const uint64_t seed = nextRandom();
+
+    // Bitsliced: all lanes step together until each has won or hit a mine
+    seedRandom(seed);
+    uint64_t start = getNanoseconds();
+    bitsliceClear(&boards);
+    bitsliceGenerate(&boards, clicks);
+    generate_ns[0] += getNanoseconds() - start;
+    start = getNanoseconds();
+    uint64_t active = ~(uint64_t)0;
+    for (int step = 0; step < cells && active; ++step) {
+      for (int lane = 0; lane < BITSLICE_LANES; ++lane) {
+        step_clicks[lane] = -1;
+        if ((active >> lane) & 1) {
+          step_clicks[lane] = clicks[step * BITSLICE_LANES + lane];
+          steps[lane] = step + 1;
+        }
+      }
+      active &= ~bitsliceOpen(&boards, step_clicks);
+      active &= ~bitsliceWon(&boards);
+    }
+    play_ns[0] += getNanoseconds() - start;
+
+    // Scalar: the same boards (same seed) and clicks, one board after the other
+    seedRandom(seed);
+    for (int lane = 0; lane < BITSLICE_LANES; ++lane) {
+      start = getNanoseconds();
+      resetGame(board);
+      generateMines(board, clicks[lane] % width, clicks[lane] / width);
+      generate_ns[1] += getNanoseconds() - start;
+      start = getNanoseconds();
+      int step = 0;
+      for (bool running = true; running && step < cells; ++step) {
+        const int cell = clicks[step * BITSLICE_LANES + lane];
+        running = openCell(board, cell % width, cell / width) && !checkWin(board);
+      }
+      play_ns[1] += getNanoseconds() - start;
+      board_steps += step;
+      bitsliceGetLane(&boards, lane, lane_board);
+      mismatches += step != steps[lane] || memcmp(board, lane_board, sizeof(uint8_t) * cells) != 0;
+    }
+    ++batches;
+  }
+
+  const uint64_t games = batches * BITSLICE_LANES;
+  printf("%dx%d, %d mines, %llu boards in batches of %d, %.1f steps per board\n", width, height, mines, (unsigned long long)games,
+         BITSLICE_LANES, (double)board_steps / games);
+  printf("%-10s %14s %14s %10s\n", "engine", "boards/s", "board steps/s", "speedup");
+  const char *names[] = {"bitslice", "scalar"};
+  for (int i = 1; i >= 0; --i) {
+    printf("%-10s %14.0f %14.0f %9.2fx\n", names[i], games / (generate_ns[i] * 1e-9), board_steps / (play_ns[i] * 1e-9),
+           (double)play_ns[1] / play_ns[i]);
+  }
+  printf("mismatching boards: %llu\n", (unsigned long long)mismatches);
+
+  free(clicks);
+  free(lane_board);
+  free(board);
+  bitsliceFree(&boards);
+  return mismatches > 0;
+}
+
+// minesweeper-sim [games] [threads] [opening|safe|any] [width height mines]
+// minesweeper-sim --bitslice [seconds] [width height mines]
+// Lets the bot play games on every difficulty (or the given size) on all cores and reports its win rate with a 95%
+// confidence interval. The policy decides what generateMines keeps free around the first click.
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bitslice") == 0) {
+    const double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+    const int width = argc > 5 ? atoi(argv[3]) : difficulty_nums[0];
+    const int height = argc > 5 ? atoi(argv[4]) : difficulty_nums[1];
+    const int mines = argc > 5 ? atoi(argv[5]) : difficulty_nums[2];
+    if (seconds <= 0.0 || width < 1 || height < 1 || mines < 0 || mines > width * height - 9) {
+      fprintf(stderr, "usage: minesweeper-sim --bitslice [seconds] [width height mines]\n");
+      return 1;
+    }
+    seedRandom((uint64_t)time(NULL));
+    return runBitsliceBench(seconds, width, height, mines);
+  }
+
+  const long long games = argc > 1 ? atoll(argv[1]) : 100000;
+  const int threads = argc > 2 ? atoi(argv[2]) : getCoreCount();
+  const char *policy_names[] = {"opening", "safe", "any"};
+  int policy = 0;
+  if (argc > 3) {
+    policy = -1;
+    for (int i = 0; i < 3; ++i) {
+      if (strcmp(argv[3], policy_names[i]) == 0) {
+        policy = i;
+      }
+    }
+  }
+  const bool custom = argc > 6;
+  const int custom_width = custom ? atoi(argv[4]) : 0;
+  const int custom_height = custom ? atoi(argv[5]) : 0;
+  const int custom_mines = custom ? atoi(argv[6]) : 0;
+  if (games < 1 || threads < 1 || policy < 0 ||
+      (custom && (custom_width < 1 || custom_height < 1 || custom_mines < 0 || custom_mines > custom_width * custom_height - 1))) {
+    fprintf(stderr, "usage: minesweeper-sim [games] [threads] [opening|safe|any] [width height mines]\n");
+    return 1;
+  }
+
+  seedRandom((uint64_t)time(NULL));
+  printf("%lld games per board on %d threads, first click policy: %s\n", games, threads, policy_names[policy]);
+  printf("%-13s %11s %8s %12s %9s %17s %8s %10s %8s %10s\n", "difficulty", "board", "density", "games", "win rate", "95% interval",
+         "guesses", "no guess", "moves", "games/s");
+  fflush(stdout);
+  if (custom) {
+    simulate("custom", custom_width, custom_height, custom_mines, (FirstClickPolicy)policy, games, threads);
+  } else {
+    const char *names[] = {"beginner", "intermediate", "expert"};
+    for (int i = 0; i < 3; ++i) {
+      simulate(names[i], difficulty_nums[i * 3 + 0], difficulty_nums[i * 3 + 1], difficulty_nums[i * 3 + 2], (FirstClickPolicy)policy,
+               games, threads);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,1037 @@
+#include "solver.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+#include "memtrack.h"
+#include "timing.h"
+
+// Components larger than this are not enumerated, their probabilities are estimated locally instead
+#define SOLVER_MAX_COMPONENT 256
+// Per component node limit so a pathological frontier can't stall a headless solve forever
+#define SOLVER_MAX_COMPONENT_NODES (1u << 22)
+// Exact global weighting (remaining mine count) is only done below these sizes, above it components are weighted
+// independently with the outside density, which converges to the same answer on large boards
+#define SOLVER_MAX_EXACT_VARS 2048
+#define SOLVER_MAX_EXACT_COMPONENTS 256
+// Vars or constraints reset per slice before enumeration
+#define PREPARE_SLICE 1024
+
+static const uint8_t var_state_unknown = 0;
+static const uint8_t var_state_safe = 1;
+static const uint8_t var_state_mine = 2;
+
+// Capacities only grow and are kept across solves, the hint solver and the bot stop allocating once they have seen their
+// largest frontier. Growing is exempt from the hot path checks, sizing for the worst case up front would take over a
+// hundred bytes per cell.
+static int64_t grownCapacity(int64_t capacity, int64_t needed) {
+  int64_t new_capacity = capacity > 0 ? capacity : 64;
+  while (new_capacity < needed) {
+    new_capacity *= 2;
+  }
+  return new_capacity;
+}
+
+static void *growArray(void *array, int64_t *capacity, int64_t needed, size_t element_size) {
+  if (needed <= *capacity) {
+    return array;
+  }
+  *capacity = grownCapacity(*capacity, needed);
+  const bool hot = memSetHotPath(false);
+  array = memRealloc(MEM_SOLVER, array, element_size * *capacity);
+  memSetHotPath(hot);
+  return array;
+}
+
+static void ensureCellCapacity(Solver *solver, int cells) {
+  if (cells <= solver->cell_capacity) {
+    return;
+  }
+  solver->cell_capacity = cells;
+  const bool hot = memSetHotPath(false);
+  solver->cell_var = memRealloc(MEM_SOLVER, solver->cell_var, sizeof(int32_t) * cells);
+  memSetHotPath(hot);
+}
+
+static void ensureVarCapacity(Solver *solver, int vars) {
+  if (vars <= solver->var_capacity) {
+    return;
+  }
+  const int previous_capacity = solver->var_capacity;
+  const int64_t capacity = grownCapacity(solver->var_capacity, vars);
+  solver->var_capacity = (int)capacity;
+  const bool hot = memSetHotPath(false);
+  solver->var_cell = memRealloc(MEM_SOLVER, solver->var_cell, sizeof(int32_t) * capacity);
+  solver->var_state = memRealloc(MEM_SOLVER, solver->var_state, sizeof(uint8_t) * capacity);
+  solver->var_num_constraints = memRealloc(MEM_SOLVER, solver->var_num_constraints, sizeof(uint8_t) * capacity);
+  solver->var_constraints = memRealloc(MEM_SOLVER, solver->var_constraints, sizeof(int32_t) * 8 * capacity);
+  solver->component = memRealloc(MEM_SOLVER, solver->component, sizeof(int32_t) * capacity);
+  solver->order = memRealloc(MEM_SOLVER, solver->order, sizeof(int32_t) * capacity);
+  solver->comp_start = memRealloc(MEM_SOLVER, solver->comp_start, sizeof(int32_t) * (capacity + 1));
+  solver->comp_failed = memRealloc(MEM_SOLVER, solver->comp_failed, sizeof(uint8_t) * capacity);
+  solver->comp_offset = memRealloc(MEM_SOLVER, solver->comp_offset, sizeof(int64_t) * capacity);
+  solver->comp_cell_offset = memRealloc(MEM_SOLVER, solver->comp_cell_offset, sizeof(int64_t) * capacity);
+  solver->choice = memRealloc(MEM_SOLVER, solver->choice, sizeof(int8_t) * capacity);
+  solver->assigned = memRealloc(MEM_SOLVER, solver->assigned, sizeof(uint8_t) * capacity);
+  solver->probability = memRealloc(MEM_SOLVER, solver->probability, sizeof(double) * capacity);
+  solver->safe_cells = memRealloc(MEM_SOLVER, solver->safe_cells, sizeof(int32_t) * capacity);
+  solver->mine_cells = memRealloc(MEM_SOLVER, solver->mine_cells, sizeof(int32_t) * capacity);
+  // Weighing scratch is only used by exact weighting, where frontier mine totals go up to the undecided var count and
+  // SOLVER_MAX_EXACT_VARS caps it. Components are capped by SOLVER_MAX_EXACT_COMPONENTS, which bounds the prefix and suffix rows.
+  if (previous_capacity < SOLVER_MAX_EXACT_VARS) {
+    const int64_t length = (capacity < SOLVER_MAX_EXACT_VARS ? capacity : SOLVER_MAX_EXACT_VARS) + 1;
+    const int64_t rows = (capacity < SOLVER_MAX_EXACT_COMPONENTS ? capacity : SOLVER_MAX_EXACT_COMPONENTS) + 1;
+    solver->weight = memRealloc(MEM_SOLVER, solver->weight, sizeof(double) * length);
+    solver->rest = memRealloc(MEM_SOLVER, solver->rest, sizeof(double) * length);
+    solver->factor = memRealloc(MEM_SOLVER, solver->factor, sizeof(double) * length);
+    solver->prefix = memRealloc(MEM_SOLVER, solver->prefix, sizeof(double) * rows * length);
+    solver->suffix = memRealloc(MEM_SOLVER, solver->suffix, sizeof(double) * rows * length);
+    solver->prefix_len = memRealloc(MEM_SOLVER, solver->prefix_len, sizeof(int32_t) * rows);
+    solver->suffix_len = memRealloc(MEM_SOLVER, solver->suffix_len, sizeof(int32_t) * rows);
+  }
+  memSetHotPath(hot);
+}
+
+static void ensureConCapacity(Solver *solver, int cons) {
+  if (cons <= solver->con_capacity) {
+    return;
+  }
+  const int64_t capacity = grownCapacity(solver->con_capacity, cons);
+  solver->con_capacity = (int)capacity;
+  const bool hot = memSetHotPath(false);
+  solver->con_remaining = memRealloc(MEM_SOLVER, solver->con_remaining, sizeof(int8_t) * capacity);
+  solver->con_num_vars = memRealloc(MEM_SOLVER, solver->con_num_vars, sizeof(uint8_t) * capacity);
+  solver->con_vars = memRealloc(MEM_SOLVER, solver->con_vars, sizeof(int32_t) * 8 * capacity);
+  solver->con_mines = memRealloc(MEM_SOLVER, solver->con_mines, sizeof(int8_t) * capacity);
+  solver->con_unassigned = memRealloc(MEM_SOLVER, solver->con_unassigned, sizeof(uint8_t) * capacity);
+  solver->queue = memRealloc(MEM_SOLVER, solver->queue, sizeof(int32_t) * (capacity + 1));
+  solver->queued = memRealloc(MEM_SOLVER, solver->queued, sizeof(uint8_t) * capacity);
+  memSetHotPath(hot);
+}
+
+static inline bool isUnknownCell(uint8_t cell) {
+  const uint8_t display_state = getDisplayState(cell);
+  return display_state == cell_display_state_closed || display_state == cell_display_state_press;
+}
+
+static inline bool isKnownMineCell(uint8_t cell) {
+  const uint8_t display_state = getDisplayState(cell);
+  return display_state == cell_display_state_flagged || display_state == cell_display_state_mine ||
+         display_state == cell_display_state_mistake;
+}
+
+void solverStart(Solver *solver, const uint8_t *board, int width, int height, int mines) {
+  solver->phase = SOLVER_PHASE_SCAN;
+  solver->result = (SolverResult){-1, false, false, 1.0f};
+  solver->board = board;
+  solver->width = width;
+  solver->height = height;
+  solver->mines = mines;
+
+  solver->scan_y = 0;
+  solver->unknown_cells = 0;
+  solver->flagged_cells = 0;
+  solver->num_vars = 0;
+  solver->num_constraints = 0;
+  solver->decided_mines = 0;
+  solver->num_safe = 0;
+  solver->num_mines_found = 0;
+  solver->nodes = 0;
+  solver->enumerated = false;
+  solver->estimate_cursor = 0;
+  solver->estimate_var = -1;
+  solver->prepare_cursor = -1;
+
+  ensureCellCapacity(solver, width * height);
+  ensureVarCapacity(solver, 64);
+  ensureConCapacity(solver, 64);
+  // Row 0 has to be ready before the first row is scanned, later rows are initialised one row ahead of the scan
+  for (int x = 0; x < width; ++x) {
+    solver->cell_var[x] = -1;
+  }
+}
+
+static int getVar(Solver *solver, int cell) {
+  if (solver->cell_var[cell] >= 0) {
+    return solver->cell_var[cell];
+  }
+  ensureVarCapacity(solver, solver->num_vars + 1);
+  const int var = solver->num_vars++;
+  solver->cell_var[cell] = var;
+  solver->var_cell[var] = cell;
+  solver->var_state[var] = var_state_unknown;
+  solver->var_num_constraints[var] = 0;
+  return var;
+}
+
+static void scanRow(Solver *solver, int y) {
+  const int width = solver->width;
+  const int height = solver->height;
+  const uint8_t *board = solver->board;
+  if (y + 1 < height) {
+    for (int x = 0; x < width; ++x) {
+      solver->cell_var[(y + 1) * width + x] = -1;
+    }
+  }
+  for (int x = 0; x < width; ++x) {
+    const uint8_t cell = board[y * width + x];
+    if (isUnknownCell(cell)) {
+      ++solver->unknown_cells;
+      continue;
+    }
+    if (isKnownMineCell(cell)) {
+      ++solver->flagged_cells;
+      continue;
+    }
+    if (getDisplayState(cell) != cell_display_state_open || getNumber(cell) == 0) {
+      continue;
+    }
+
+    int neighbors[8];
+    int num_unknown = 0;
+    int num_flagged = 0;
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        const int nx = x + dx;
+        const int ny = y + dy;
+        if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= width || ny >= height) {
+          continue;
+        }
+        const uint8_t neighbor = board[ny * width + nx];
+        if (isUnknownCell(neighbor)) {
+          neighbors[num_unknown++] = ny * width + nx;
+        } else if (isKnownMineCell(neighbor)) {
+          ++num_flagged;
+        }
+      }
+    }
+    if (num_unknown == 0) {
+      continue;
+    }
+
+    ensureConCapacity(solver, solver->num_constraints + 1);
+    const int con = solver->num_constraints++;
+    solver->con_remaining[con] = (int8_t)(getNumber(cell) - num_flagged);
+    solver->con_num_vars[con] = (uint8_t)num_unknown;
+    for (int i = 0; i < num_unknown; ++i) {
+      const int var = getVar(solver, neighbors[i]);
+      solver->con_vars[con * 8 + i] = var;
+      solver->var_constraints[var * 8 + solver->var_num_constraints[var]++] = con;
+    }
+  }
+}
+
+static void enqueue(Solver *solver, int con) {
+  if (solver->queued[con]) {
+    return;
+  }
+  solver->queued[con] = true;
+  solver->queue[solver->queue_tail] = con;
+  solver->queue_tail = (solver->queue_tail + 1) % (solver->num_constraints + 1);
+}
+
+static void decideVar(Solver *solver, int var, uint8_t state) {
+  if (solver->var_state[var] != var_state_unknown) {
+    return;
+  }
+  solver->var_state[var] = state;
+  if (state == var_state_safe) {
+    solver->safe_cells[solver->num_safe++] = solver->var_cell[var];
+  } else {
+    solver->mine_cells[solver->num_mines_found++] = solver->var_cell[var];
+    ++solver->decided_mines;
+  }
+  solver->subset_changed = true;
+  for (int i = 0; i < solver->var_num_constraints[var]; ++i) {
+    enqueue(solver, solver->var_constraints[var * 8 + i]);
+  }
+}
+
+// Remaining mines and live (undecided) vars of a constraint
+static int liveVars(const Solver *solver, int con, int *live, int *remaining) {
+  int num_live = 0;
+  int mines = 0;
+  for (int i = 0; i < solver->con_num_vars[con]; ++i) {
+    const int var = solver->con_vars[con * 8 + i];
+    if (solver->var_state[var] == var_state_unknown) {
+      live[num_live++] = var;
+    } else if (solver->var_state[var] == var_state_mine) {
+      ++mines;
+    }
+  }
+  *remaining = solver->con_remaining[con] - mines;
+  return num_live;
+}
+
+static void applyTrivialRule(Solver *solver, int con) {
+  int live[8];
+  int remaining;
+  const int num_live = liveVars(solver, con, live, &remaining);
+  if (num_live == 0) {
+    return;
+  }
+  if (remaining == 0) {
+    for (int i = 0; i < num_live; ++i) {
+      decideVar(solver, live[i], var_state_safe);
+    }
+  } else if (remaining == num_live) {
+    for (int i = 0; i < num_live; ++i) {
+      decideVar(solver, live[i], var_state_mine);
+    }
+  }
+}
+
+// If the live vars of a are a subset of the live vars of b, the difference holds exactly remaining(b) - remaining(a) mines
+static void applySubsetRule(Solver *solver, int a) {
+  int live_a[8];
+  int remaining_a;
+  const int num_live_a = liveVars(solver, a, live_a, &remaining_a);
+  if (num_live_a == 0) {
+    return;
+  }
+  const int var = live_a[0];
+  for (int i = 0; i < solver->var_num_constraints[var]; ++i) {
+    const int b = solver->var_constraints[var * 8 + i];
+    if (b == a) {
+      continue;
+    }
+    int live_b[8];
+    int remaining_b;
+    const int num_live_b = liveVars(solver, b, live_b, &remaining_b);
+    if (num_live_b <= num_live_a) {
+      continue;
+    }
+    int difference[8];
+    int num_difference = 0;
+    int num_shared = 0;
+    for (int j = 0; j < num_live_b; ++j) {
+      bool shared = false;
+      for (int k = 0; k < num_live_a; ++k) {
+        if (live_b[j] == live_a[k]) {
+          shared = true;
+          break;
+        }
+      }
+      if (shared) {
+        ++num_shared;
+      } else {
+        difference[num_difference++] = live_b[j];
+      }
+    }
+    if (num_shared != num_live_a) {
+      continue;
+    }
+    const int difference_mines = remaining_b - remaining_a;
+    if (difference_mines == 0) {
+      for (int j = 0; j < num_difference; ++j) {
+        decideVar(solver, difference[j], var_state_safe);
+      }
+    } else if (difference_mines == num_difference) {
+      for (int j = 0; j < num_difference; ++j) {
+        decideVar(solver, difference[j], var_state_mine);
+      }
+    }
+  }
+}
+
+static void startRules(Solver *solver) {
+  solver->queue_head = 0;
+  solver->queue_tail = 0;
+  memset(solver->queued, 0, sizeof(uint8_t) * solver->num_constraints);
+  for (int con = 0; con < solver->num_constraints; ++con) {
+    enqueue(solver, con);
+  }
+  solver->subset_cursor = 0;
+  solver->subset_changed = false;
+}
+
+// Returns true when no rule can decide anything else
+static bool stepRules(Solver *solver) {
+  if (solver->queue_head != solver->queue_tail) {
+    const int con = solver->queue[solver->queue_head];
+    solver->queue_head = (solver->queue_head + 1) % (solver->num_constraints + 1);
+    solver->queued[con] = false;
+    applyTrivialRule(solver, con);
+  } else if (solver->subset_cursor < solver->num_constraints) {
+    applySubsetRule(solver, solver->subset_cursor++);
+  } else if (solver->subset_changed) {
+    solver->subset_changed = false;
+    solver->subset_cursor = 0;
+  } else {
+    return true;
+  }
+  return false;
+}
+
+// Resets the vars and then the constraints a slice per call, returns true once both are ready to be split into components
+static bool prepareEnumeration(Solver *solver) {
+  const int num_vars = solver->num_vars;
+  const int end = solver->prepare_cursor + PREPARE_SLICE;
+  for (; solver->prepare_cursor < end && solver->prepare_cursor < num_vars; ++solver->prepare_cursor) {
+    solver->component[solver->prepare_cursor] = -1;
+  }
+  for (; solver->prepare_cursor < end && solver->prepare_cursor < num_vars + solver->num_constraints; ++solver->prepare_cursor) {
+    const int con = solver->prepare_cursor - num_vars;
+    int live[8];
+    int remaining;
+    solver->con_unassigned[con] = (uint8_t)liveVars(solver, con, live, &remaining);
+    solver->con_mines[con] = (int8_t)(solver->con_remaining[con] - remaining);
+  }
+  return solver->prepare_cursor >= num_vars + solver->num_constraints;
+}
+
+static void startEnumeration(Solver *solver) {
+  const int num_vars = solver->num_vars;
+
+  // Split the undecided frontier into independent components, BFS order keeps each enumeration step close to the last one
+  int num_ordered = 0;
+  solver->num_components = 0;
+  int64_t counts_needed = 0;
+  int64_t cell_counts_needed = 0;
+  for (int root = 0; root < num_vars; ++root) {
+    if (solver->var_state[root] != var_state_unknown || solver->component[root] >= 0) {
+      continue;
+    }
+    const int comp = solver->num_components++;
+    const int start = num_ordered;
+    solver->comp_start[comp] = start;
+    solver->component[root] = comp;
+    solver->order[num_ordered++] = root;
+    for (int head = start; head < num_ordered; ++head) {
+      const int var = solver->order[head];
+      for (int i = 0; i < solver->var_num_constraints[var]; ++i) {
+        const int con = solver->var_constraints[var * 8 + i];
+        for (int j = 0; j < solver->con_num_vars[con]; ++j) {
+          const int other = solver->con_vars[con * 8 + j];
+          if (solver->var_state[other] == var_state_unknown && solver->component[other] < 0) {
+            solver->component[other] = comp;
+            solver->order[num_ordered++] = other;
+          }
+        }
+      }
+    }
+    const int size = num_ordered - start;
+    solver->comp_failed[comp] = size > SOLVER_MAX_COMPONENT;
+    solver->comp_offset[comp] = counts_needed;
+    solver->comp_cell_offset[comp] = cell_counts_needed;
+    if (!solver->comp_failed[comp]) {
+      counts_needed += size + 1;
+      cell_counts_needed += (int64_t)(size + 1) * size;
+    }
+  }
+  solver->comp_start[solver->num_components] = num_ordered;
+
+  solver->comp_counts = growArray(solver->comp_counts, &solver->count_capacity, counts_needed, sizeof(double));
+  solver->comp_cell_counts = growArray(solver->comp_cell_counts, &solver->cell_count_capacity, cell_counts_needed, sizeof(double));
+  if (counts_needed > 0) {
+    memset(solver->comp_counts, 0, sizeof(double) * counts_needed);
+  }
+  if (cell_counts_needed > 0) {
+    memset(solver->comp_cell_counts, 0, sizeof(double) * cell_counts_needed);
+  }
+
+  solver->current_component = 0;
+  solver->depth = 0;
+  solver->comp_mines = 0;
+  solver->comp_nodes = 0;
+  if (solver->num_components > 0) {
+    const int size = solver->comp_start[1] - solver->comp_start[0];
+    memset(solver->choice, -1, sizeof(int8_t) * size);
+    memset(solver->assigned, 0, sizeof(uint8_t) * size);
+  }
+}
+
+static bool canAssign(const Solver *solver, int var, int value, int mines_available) {
+  if (value == 1 && solver->comp_mines + 1 > mines_available) {
+    return false;
+  }
+  for (int i = 0; i < solver->var_num_constraints[var]; ++i) {
+    const int con = solver->var_constraints[var * 8 + i];
+    const int mines = solver->con_mines[con] + value;
+    const int target = solver->con_remaining[con];
+    if (mines > target || mines + (solver->con_unassigned[con] - 1) < target) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void assign(Solver *solver, int var, int value, int direction) {
+  for (int i = 0; i < solver->var_num_constraints[var]; ++i) {
+    const int con = solver->var_constraints[var * 8 + i];
+    solver->con_mines[con] += value * direction;
+    solver->con_unassigned[con] -= direction;
+  }
+  solver->comp_mines += value * direction;
+}
+
+static void nextComponent(Solver *solver) {
+  ++solver->current_component;
+  solver->depth = 0;
+  solver->comp_mines = 0;
+  solver->comp_nodes = 0;
+  if (solver->current_component < solver->num_components) {
+    const int size = solver->comp_start[solver->current_component + 1] - solver->comp_start[solver->current_component];
+    memset(solver->choice, -1, sizeof(int8_t) * size);
+    memset(solver->assigned, 0, sizeof(uint8_t) * size);
+  }
+}
+
+// Undo every assignment of a component that was abandoned half way through
+static void abandonComponent(Solver *solver, int start, int size) {
+  for (int d = 0; d < size; ++d) {
+    if (solver->assigned[d]) {
+      assign(solver, solver->order[start + d], solver->choice[d], -1);
+    }
+  }
+}
+
+// Enumerates up to `nodes` search nodes, returns true when every component is finished
+static bool stepEnumeration(Solver *solver, uint32_t nodes) {
+  const int mines_available = solver->mines - solver->flagged_cells - solver->decided_mines;
+  while (solver->current_component < solver->num_components) {
+    const int comp = solver->current_component;
+    const int start = solver->comp_start[comp];
+    const int size = solver->comp_start[comp + 1] - start;
+    if (solver->comp_failed[comp]) {
+      nextComponent(solver);
+      continue;
+    }
+    double *counts = solver->comp_counts + solver->comp_offset[comp];
+    double *cell_counts = solver->comp_cell_counts + solver->comp_cell_offset[comp];
+
+    while (true) {
+      if (nodes-- == 0) {
+        return false;
+      }
+      ++solver->nodes;
+      if (++solver->comp_nodes > SOLVER_MAX_COMPONENT_NODES) {
+        abandonComponent(solver, start, size);
+        solver->comp_failed[comp] = true;
+        break;
+      }
+
+      const int d = solver->depth;
+      const int var = solver->order[start + d];
+      if (solver->assigned[d]) {
+        assign(solver, var, solver->choice[d], -1);
+        solver->assigned[d] = false;
+      }
+      if (solver->choice[d] == 1) {
+        solver->choice[d] = -1;
+        if (d == 0) {
+          break;
+        }
+        --solver->depth;
+        continue;
+      }
+      ++solver->choice[d];
+      if (!canAssign(solver, var, solver->choice[d], mines_available)) {
+        continue;
+      }
+      assign(solver, var, solver->choice[d], 1);
+      solver->assigned[d] = true;
+      if (d + 1 < size) {
+        ++solver->depth;
+        continue;
+      }
+
+      // Complete solution
+      const int k = solver->comp_mines;
+      counts[k] += 1.0;
+      for (int i = 0; i < size; ++i) {
+        if (solver->choice[i] == 1) {
+          cell_counts[(int64_t)k * size + i] += 1.0;
+        }
+      }
+    }
+    nextComponent(solver);
+  }
+  return true;
+}
+
+static double logChoose(int n, int k) { return lgamma(n + 1.0) - lgamma(k + 1.0) - lgamma(n - k + 1.0); }
+
+// out[0..a_len + b_len - 1) = a * b, rescaled so its largest entry is 1 (every caller only needs ratios)
+static int convolve(const double *a, int a_len, const double *b, int b_len, double *out) {
+  const int out_len = a_len + b_len - 1;
+  for (int i = 0; i < out_len; ++i) {
+    out[i] = 0.0;
+  }
+  double largest = 0.0;
+  for (int i = 0; i < a_len; ++i) {
+    if (a[i] == 0.0) {
+      continue;
+    }
+    for (int j = 0; j < b_len; ++j) {
+      out[i + j] += a[i] * b[j];
+    }
+  }
+  for (int i = 0; i < out_len; ++i) {
+    if (out[i] > largest) {
+      largest = out[i];
+    }
+  }
+  if (largest > 0.0) {
+    for (int i = 0; i < out_len; ++i) {
+      out[i] /= largest;
+    }
+  }
+  return out_len;
+}
+
+// Local estimate for vars of components that were too large to enumerate
+static double estimateVar(const Solver *solver, int var) {
+  double estimate = 0.0;
+  for (int i = 0; i < solver->var_num_constraints[var]; ++i) {
+    int live[8];
+    int remaining;
+    const int num_live = liveVars(solver, solver->var_constraints[var * 8 + i], live, &remaining);
+    if (num_live > 0 && (double)remaining / num_live > estimate) {
+      estimate = (double)remaining / num_live;
+    }
+  }
+  return estimate;
+}
+
+// Stages of the weighing phase, each step does one row of weights or one component
+enum {
+  WEIGH_LOG,         // exact: log of the outside weight per frontier mine total
+  WEIGH_SCALE,       // exact: normalised out of log space
+  WEIGH_PREFIX,      // exact: counts of components [0, c) convolved
+  WEIGH_SUFFIX,      // exact: counts of components [c, n) convolved
+  WEIGH_TOTAL,       // exact: outside probability from all components together
+  WEIGH_EXACT,       // exact: probabilities of one component against the rest
+  WEIGH_INDEPENDENT, // each component weighted by the outside odds alone
+  WEIGH_DONE
+};
+
+// Mine totals handled per weight step
+#define WEIGH_ROW 256
+
+static void startWeighing(Solver *solver) {
+  const int num_components = solver->num_components;
+  const int undecided = solver->comp_start[num_components];
+  solver->weigh_exact = undecided <= SOLVER_MAX_EXACT_VARS && num_components <= SOLVER_MAX_EXACT_COMPONENTS;
+  for (int comp = 0; comp < num_components; ++comp) {
+    if (solver->comp_failed[comp]) {
+      solver->weigh_exact = false;
+    }
+  }
+  const int mines_left_total = solver->mines - solver->flagged_cells - solver->decided_mines;
+  const int outside = solver->unknown_cells - solver->num_vars;
+  solver->outside_probability = outside > 0 ? (double)mines_left_total / (undecided + outside) : 0.0;
+  solver->weigh_max_log = -HUGE_VAL;
+  solver->weigh_stage = solver->weigh_exact ? WEIGH_LOG : WEIGH_INDEPENDENT;
+  solver->weigh_cursor = 0;
+}
+
+// Weight of a frontier mine total K is C(outside, mines_left_total - K), kept in log space and normalised
+static void weighLogRow(Solver *solver, int max_total) {
+  const int mines_left_total = solver->mines - solver->flagged_cells - solver->decided_mines;
+  const int outside = solver->unknown_cells - solver->num_vars;
+  const int end = solver->weigh_cursor + WEIGH_ROW <= max_total + 1 ? solver->weigh_cursor + WEIGH_ROW : max_total + 1;
+  for (int k = solver->weigh_cursor; k < end; ++k) {
+    const int rest = mines_left_total - k;
+    solver->weight[k] = (rest < 0 || rest > outside) ? -HUGE_VAL : logChoose(outside, rest);
+    if (solver->weight[k] > solver->weigh_max_log) {
+      solver->weigh_max_log = solver->weight[k];
+    }
+  }
+  solver->weigh_cursor = end;
+}
+
+static void weighScaleRow(Solver *solver, int max_total) {
+  const int end = solver->weigh_cursor + WEIGH_ROW <= max_total + 1 ? solver->weigh_cursor + WEIGH_ROW : max_total + 1;
+  for (int k = solver->weigh_cursor; k < end; ++k) {
+    solver->weight[k] = solver->weight[k] == -HUGE_VAL ? 0.0 : exp(solver->weight[k] - solver->weigh_max_log);
+  }
+  solver->weigh_cursor = end;
+}
+
+static void weighTotal(Solver *solver, int max_total) {
+  const int mines_left_total = solver->mines - solver->flagged_cells - solver->decided_mines;
+  const int outside = solver->unknown_cells - solver->num_vars;
+  const double *all = solver->prefix + (int64_t)solver->num_components * (max_total + 1);
+  double total = 0.0;
+  double expected_outside = 0.0;
+  for (int k = 0; k < solver->prefix_len[solver->num_components]; ++k) {
+    total += all[k] * solver->weight[k];
+    expected_outside += all[k] * solver->weight[k] * (mines_left_total - k);
+  }
+  if (outside > 0 && total > 0.0) {
+    solver->outside_probability = expected_outside / total / outside;
+  }
+}
+
+static void weighExactComponent(Solver *solver, int comp, int max_total) {
+  const int start = solver->comp_start[comp];
+  const int size = solver->comp_start[comp + 1] - start;
+  const double *weight = solver->weight;
+  double *rest = solver->rest;
+  double *factor = solver->factor;
+  const int rest_len = convolve(solver->prefix + (int64_t)comp * (max_total + 1), solver->prefix_len[comp],
+                                solver->suffix + (int64_t)(comp + 1) * (max_total + 1), solver->suffix_len[comp + 1], rest);
+  const double *counts = solver->comp_counts + solver->comp_offset[comp];
+  const double *cell_counts = solver->comp_cell_counts + solver->comp_cell_offset[comp];
+  double comp_total = 0.0;
+  for (int k = 0; k <= size; ++k) {
+    factor[k] = 0.0;
+    for (int j = 0; j < rest_len && k + j <= max_total; ++j) {
+      factor[k] += rest[j] * weight[k + j];
+    }
+    comp_total += counts[k] * factor[k];
+  }
+  for (int i = 0; i < size; ++i) {
+    double mined = 0.0;
+    double clear = 0.0;
+    for (int k = 0; k <= size; ++k) {
+      mined += cell_counts[(int64_t)k * size + i] * factor[k];
+      clear += (counts[k] - cell_counts[(int64_t)k * size + i]) * factor[k];
+    }
+    // Exact zeros make the certain answers exact too
+    solver->probability[start + i] = clear == 0.0 ? 1.0 : (mined == 0.0 ? 0.0 : mined / comp_total);
+  }
+}
+
+// Independent components, each mine in a component weighted by the outside odds
+static void weighIndependentComponent(Solver *solver, int comp) {
+  const int mines_left_total = solver->mines - solver->flagged_cells - solver->decided_mines;
+  const int outside = solver->unknown_cells - solver->num_vars;
+  const int undecided = solver->comp_start[solver->num_components];
+  const double density = (undecided + outside) > 0 ? (double)mines_left_total / (undecided + outside) : 0.0;
+  const double odds = density <= 0.0 ? 0.0 : (density >= 1.0 ? 1e300 : density / (1.0 - density));
+  const int start = solver->comp_start[comp];
+  const int size = solver->comp_start[comp + 1] - start;
+  if (solver->comp_failed[comp]) {
+    for (int i = 0; i < size; ++i) {
+      solver->probability[start + i] = estimateVar(solver, solver->order[start + i]);
+    }
+    return;
+  }
+  const double *counts = solver->comp_counts + solver->comp_offset[comp];
+  const double *cell_counts = solver->comp_cell_counts + solver->comp_cell_offset[comp];
+  double comp_total = 0.0;
+  double scale = 1.0;
+  for (int k = 0; k <= size; ++k) {
+    comp_total += counts[k] * scale;
+    scale *= odds;
+  }
+  for (int i = 0; i < size; ++i) {
+    double mined = 0.0;
+    double clear = 0.0;
+    scale = 1.0;
+    for (int k = 0; k <= size; ++k) {
+      mined += cell_counts[(int64_t)k * size + i] * scale;
+      clear += (counts[k] - cell_counts[(int64_t)k * size + i]) * scale;
+      scale *= odds;
+    }
+    solver->probability[start + i] = clear == 0.0 ? 1.0 : (mined == 0.0 ? 0.0 : mined / comp_total);
+  }
+}
+
+// One step of filling solver->probability for every undecided var and the outside cell mine probability, true once done
+static bool stepWeighing(Solver *solver) {
+  const int num_components = solver->num_components;
+  const int max_total = solver->comp_start[num_components];
+  const int64_t row = max_total + 1;
+  switch (solver->weigh_stage) {
+  case WEIGH_LOG:
+    weighLogRow(solver, max_total);
+    if (solver->weigh_cursor > max_total) {
+      solver->weigh_stage = WEIGH_SCALE;
+      solver->weigh_cursor = 0;
+    }
+    break;
+  case WEIGH_SCALE:
+    weighScaleRow(solver, max_total);
+    if (solver->weigh_cursor > max_total) {
+      solver->weigh_stage = WEIGH_PREFIX;
+      solver->weigh_cursor = 0;
+    }
+    break;
+  case WEIGH_PREFIX: {
+    const int comp = solver->weigh_cursor++;
+    if (comp == 0) {
+      solver->prefix[0] = 1.0;
+      solver->prefix_len[0] = 1;
+      solver->suffix[num_components * row] = 1.0;
+      solver->suffix_len[num_components] = 1;
+    }
+    if (comp < num_components) {
+      const int size = solver->comp_start[comp + 1] - solver->comp_start[comp];
+      const double *counts = solver->comp_counts + solver->comp_offset[comp];
+      solver->prefix_len[comp + 1] =
+          convolve(solver->prefix + comp * row, solver->prefix_len[comp], counts, size + 1, solver->prefix + (comp + 1) * row);
+    } else {
+      solver->weigh_stage = WEIGH_SUFFIX;
+      solver->weigh_cursor = num_components - 1;
+    }
+    break;
+  }
+  case WEIGH_SUFFIX: {
+    const int comp = solver->weigh_cursor--;
+    if (comp >= 0) {
+      const int size = solver->comp_start[comp + 1] - solver->comp_start[comp];
+      const double *counts = solver->comp_counts + solver->comp_offset[comp];
+      solver->suffix_len[comp] =
+          convolve(solver->suffix + (comp + 1) * row, solver->suffix_len[comp + 1], counts, size + 1, solver->suffix + comp * row);
+    } else {
+      solver->weigh_stage = WEIGH_TOTAL;
+    }
+    break;
+  }
+  case WEIGH_TOTAL:
+    weighTotal(solver, max_total);
+    solver->weigh_stage = WEIGH_EXACT;
+    solver->weigh_cursor = 0;
+    break;
+  case WEIGH_EXACT:
+  case WEIGH_INDEPENDENT: {
+    const int comp = solver->weigh_cursor++;
+    if (comp >= num_components) {
+      solver->weigh_stage = WEIGH_DONE;
+    } else if (solver->weigh_stage == WEIGH_EXACT) {
+      weighExactComponent(solver, comp, max_total);
+    } else {
+      weighIndependentComponent(solver, comp);
+    }
+    break;
+  }
+  }
+  return solver->weigh_stage == WEIGH_DONE;
+}
+
+// First unknown cell that no open number touches, corners first since they are the most likely to be zeros
+static int findOutsideCell(const Solver *solver) {
+  const int width = solver->width;
+  const int height = solver->height;
+  const int corners[4] = {0, width - 1, (height - 1) * width, height * width - 1};
+  for (int i = 0; i < 4; ++i) {
+    if (isUnknownCell(solver->board[corners[i]]) && solver->cell_var[corners[i]] < 0) {
+      return corners[i];
+    }
+  }
+  for (int cell = 0; cell < width * height; ++cell) {
+    if (isUnknownCell(solver->board[cell]) && solver->cell_var[cell] < 0) {
+      return cell;
+    }
+  }
+  return -1;
+}
+
+// Carries on through the vars from where the last call stopped until the deadline or one full pass, keeping the var with
+// the lowest local estimate. Vars decided since they were looked at drop out.
+static void refreshEstimate(Solver *solver, uint64_t deadline) {
+  if (solver->estimate_var >= 0 && solver->var_state[solver->estimate_var] != var_state_unknown) {
+    solver->estimate_var = -1;
+  }
+  for (int i = 0; i < solver->num_vars; ++i) {
+    const int var = solver->estimate_cursor;
+    solver->estimate_cursor = (var + 1) % solver->num_vars;
+    if (solver->var_state[var] == var_state_unknown) {
+      const double estimate = estimateVar(solver, var);
+      if (solver->estimate_var < 0 || estimate < solver->estimate) {
+        solver->estimate = estimate;
+        solver->estimate_var = var;
+      }
+    }
+    if ((i & 63) == 63 && getNanoseconds() > deadline) {
+      break;
+    }
+  }
+}
+
+// Best answer from what is known so far, exact once every component has been enumerated. Before that the vars are only
+// estimated for as long as the deadline allows.
+static void updateResult(Solver *solver, bool enumerated, uint64_t deadline) {
+  if (solver->num_safe > 0) {
+    solver->result = (SolverResult){solver->safe_cells[0], true, true, 0.0f};
+    return;
+  }
+
+  bool exact = false;
+  double outside_probability;
+  const int outside = solver->unknown_cells - solver->num_vars;
+  const int undecided = enumerated ? solver->comp_start[solver->num_components] : 0;
+  if (enumerated) {
+    exact = solver->weigh_exact;
+    outside_probability = solver->outside_probability;
+    for (int i = 0; i < undecided; ++i) {
+      const int var = solver->order[i];
+      if (solver->probability[i] == 0.0) {
+        solver->var_state[var] = var_state_safe;
+        solver->safe_cells[solver->num_safe++] = solver->var_cell[var];
+      } else if (solver->probability[i] == 1.0) {
+        solver->var_state[var] = var_state_mine;
+        solver->mine_cells[solver->num_mines_found++] = solver->var_cell[var];
+      }
+    }
+    if (solver->num_safe > 0) {
+      solver->result = (SolverResult){solver->safe_cells[0], true, true, 0.0f};
+      return;
+    }
+  } else {
+    const int mines_left_total = solver->mines - solver->flagged_cells - solver->decided_mines;
+    const int unknown = solver->unknown_cells - solver->num_mines_found;
+    outside_probability = unknown > 0 ? (double)mines_left_total / unknown : 1.0;
+  }
+
+  int best_cell = -1;
+  double best_probability = 2.0;
+  if (enumerated) {
+    for (int i = 0; i < undecided; ++i) {
+      if (solver->probability[i] < best_probability) {
+        best_probability = solver->probability[i];
+        best_cell = solver->var_cell[solver->order[i]];
+      }
+    }
+  } else {
+    refreshEstimate(solver, deadline);
+    if (solver->estimate_var >= 0) {
+      best_probability = solver->estimate;
+      best_cell = solver->var_cell[solver->estimate_var];
+    }
+  }
+  if (outside > 0 && outside_probability < best_probability) {
+    const int cell = findOutsideCell(solver);
+    if (cell >= 0) {
+      best_probability = outside_probability;
+      best_cell = cell;
+    }
+  }
+  if (best_cell < 0) {
+    solver->result = (SolverResult){-1, false, exact, 1.0f};
+    return;
+  }
+  solver->result = (SolverResult){best_cell, best_probability <= 0.0, exact, (float)best_probability};
+}
+
+bool solverStep(Solver *solver, double budget_seconds) {
+  const uint64_t deadline = budget_seconds > 0.0 ? getNanoseconds() + (uint64_t)(budget_seconds * 1e9) : UINT64_MAX;
+
+  while (solver->phase == SOLVER_PHASE_SCAN) {
+    if (solver->scan_y >= solver->height) {
+      startRules(solver);
+      solver->phase = SOLVER_PHASE_RULES;
+      break;
+    }
+    scanRow(solver, solver->scan_y++);
+    if (getNanoseconds() > deadline) {
+      return false;
+    }
+  }
+
+  if (solver->phase == SOLVER_PHASE_RULES) {
+    uint32_t steps = 0;
+    while (!stepRules(solver)) {
+      if ((++steps & 63) == 0 && getNanoseconds() > deadline) {
+        updateResult(solver, false, deadline);
+        return false;
+      }
+    }
+    if (solver->num_safe > 0) {
+      updateResult(solver, false, deadline);
+      solver->phase = SOLVER_PHASE_DONE;
+      return true;
+    }
+    solver->prepare_cursor = 0;
+    solver->phase = SOLVER_PHASE_ENUMERATE;
+    updateResult(solver, false, deadline);
+  }
+
+  if (solver->phase == SOLVER_PHASE_ENUMERATE && solver->prepare_cursor >= 0) {
+    while (!prepareEnumeration(solver)) {
+      if (getNanoseconds() > deadline) {
+        return false;
+      }
+    }
+    startEnumeration(solver);
+    solver->prepare_cursor = -1;
+  }
+
+  if (solver->phase == SOLVER_PHASE_ENUMERATE) {
+    while (!stepEnumeration(solver, 1024)) {
+      if (getNanoseconds() > deadline) {
+        return false;
+      }
+    }
+    startWeighing(solver);
+    solver->phase = SOLVER_PHASE_WEIGH;
+    if (getNanoseconds() > deadline) {
+      return false;
+    }
+  }
+
+  if (solver->phase == SOLVER_PHASE_WEIGH) {
+    while (!stepWeighing(solver)) {
+      if (getNanoseconds() > deadline) {
+        return false;
+      }
+    }
+    solver->enumerated = true;
+    updateResult(solver, true, deadline);
+    solver->phase = SOLVER_PHASE_DONE;
+  }
+
+  return solver->phase == SOLVER_PHASE_DONE;
+}
+
+double solverCellProbability(const Solver *solver, int cell) {
+  const int var = solver->phase == SOLVER_PHASE_DONE ? solver->cell_var[cell] : -1;
+  if (var < 0) {
+    return -1.0;
+  }
+  if (solver->var_state[var] == var_state_safe) {
+    return 0.0;
+  }
+  if (solver->var_state[var] == var_state_mine) {
+    return 1.0;
+  }
+  if (solver->enumerated) {
+    for (int i = 0; i < solver->comp_start[solver->num_components]; ++i) {
+      if (solver->order[i] == var) {
+        return solver->probability[i];
+      }
+    }
+  }
+  return -1.0;
+}
+
+void solverFree(Solver *solver) {
+  memFree(solver->cell_var);
+  memFree(solver->var_cell);
+  memFree(solver->var_state);
+  memFree(solver->var_num_constraints);
+  memFree(solver->var_constraints);
+  memFree(solver->con_remaining);
+  memFree(solver->con_num_vars);
+  memFree(solver->con_vars);
+  memFree(solver->queue);
+  memFree(solver->queued);
+  memFree(solver->component);
+  memFree(solver->order);
+  memFree(solver->comp_start);
+  memFree(solver->comp_failed);
+  memFree(solver->choice);
+  memFree(solver->assigned);
+  memFree(solver->con_mines);
+  memFree(solver->con_unassigned);
+  memFree(solver->comp_counts);
+  memFree(solver->comp_cell_counts);
+  memFree(solver->comp_offset);
+  memFree(solver->comp_cell_offset);
+  memFree(solver->probability);
+  memFree(solver->weight);
+  memFree(solver->rest);
+  memFree(solver->factor);
+  memFree(solver->prefix);
+  memFree(solver->suffix);
+  memFree(solver->prefix_len);
+  memFree(solver->suffix_len);
+  memFree(solver->safe_cells);
+  memFree(solver->mine_cells);
+  *solver = (Solver){0};
+}
@@ -0,0 +1,126 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Anytime solver: solverStep() does as much work as the budget allows and can be resumed on a later call, while
+// solver->result always holds the best answer found so far. Only information a player can see is used: closed and pressed
+// cells are unknown, flags are trusted as mines, numbers are only read from open cells.
+
+typedef enum SolverPhase {
+  SOLVER_PHASE_IDLE,
+  SOLVER_PHASE_SCAN,
+  SOLVER_PHASE_RULES,
+  SOLVER_PHASE_ENUMERATE,
+  SOLVER_PHASE_WEIGH,
+  SOLVER_PHASE_DONE
+} SolverPhase;
+
+typedef struct SolverResult {
+  int cell;                // best cell to open (index into the board), -1 if there is nothing left to open
+  bool certain;            // cell is proven safe
+  bool exact;              // mine_probability comes from a complete enumeration
+  float mine_probability;  // of cell
+} SolverResult;
+
+typedef struct Solver {
+  SolverPhase phase;
+  SolverResult result;
+
+  const uint8_t *board;
+  int width;
+  int height;
+  int mines;
+
+  // Scan
+  int scan_y;
+  int unknown_cells;
+  int flagged_cells;
+  int32_t *cell_var; // width * height, -1 when the cell is not a frontier variable
+
+  // Frontier variables and the constraints (open numbers) over them
+  int num_vars;
+  int32_t *var_cell;
+  uint8_t *var_state; // 0: unknown, 1: safe, 2: mine
+  uint8_t *var_num_constraints;
+  int32_t *var_constraints; // 8 per var
+  int num_constraints;
+  int8_t *con_remaining;
+  uint8_t *con_num_vars;
+  int32_t *con_vars; // 8 per constraint
+
+  // Rules
+  int32_t *queue;
+  uint8_t *queued;
+  int queue_head;
+  int queue_tail;
+  int subset_cursor;
+  bool subset_changed;
+  int decided_mines;
+  // Vars then constraints reset before enumeration, -1 once the frontier has been split into components
+  int prepare_cursor;
+  // Local estimates behind the interim result, a slice of vars per call so it stays within the budget
+  int estimate_cursor;
+  int estimate_var;
+  double estimate;
+
+  // Enumerate
+  int32_t *component;   // per var, -1 until assigned
+  int32_t *order;       // vars grouped by component, BFS order inside each one
+  int32_t *comp_start;  // num_components + 1 offsets into order
+  uint8_t *comp_failed; // too large, or gave up after too many nodes
+  int num_components;
+  int current_component;
+  int depth;
+  int comp_mines;
+  int8_t *choice;
+  uint8_t *assigned;
+  int8_t *con_mines;
+  uint8_t *con_unassigned;
+  double *comp_counts;      // per component, (size + 1) solution counts indexed by mine count
+  double *comp_cell_counts; // per component, (size + 1) * size counts of solutions with the cell mined
+  int64_t *comp_offset;     // per component offset into comp_counts
+  int64_t *comp_cell_offset; // per component offset into comp_cell_counts
+  uint32_t comp_nodes;
+  uint64_t nodes;
+  double *probability; // mine probability per entry of order, filled once enumeration is done
+  bool enumerated;
+
+  // Weigh: component counts combined by the remaining mine count, a row of weights or one component per step
+  int weigh_stage;
+  int weigh_cursor;
+  bool weigh_exact;
+  double weigh_max_log;
+  double outside_probability;
+  double *weight;      // exact weighting only, per frontier mine total like rest and factor
+  double *rest;
+  double *factor;
+  double *prefix;      // exact weighting only, a row of max total + 1 per component + 1
+  double *suffix;
+  int32_t *prefix_len;
+  int32_t *suffix_len;
+
+  // Output: every cell the solver has proven safe or mined
+  int num_safe;
+  int32_t *safe_cells;
+  int num_mines_found;
+  int32_t *mine_cells;
+
+  // Capacities so a solver can be reused without reallocating, the weighing scratch is sized from var_capacity
+  int cell_capacity;
+  int var_capacity;
+  int con_capacity;
+  int64_t count_capacity;
+  int64_t cell_count_capacity;
+} Solver;
+
+void solverStart(Solver *solver, const uint8_t *board, int width, int height, int mines);
+// Returns true once the answer is final. budget_seconds <= 0 means run to completion.
+bool solverStep(Solver *solver, double budget_seconds);
+// Mine probability of a frontier cell once solving is done: 0 or 1 when proven, the enumerated estimate otherwise. -1 for
+// cells that are not on the frontier, or when the answer came from the rules alone.
+double solverCellProbability(const Solver *solver, int cell);
+void solverFree(Solver *solver);
+
+#endif
@@ -0,0 +1,415 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bot.h"
+#include "engine.h"
+#include "solver.h"
+#include "timing.h"
+
+// Corpus position files (bench/corpus/*.txt), listed one per line in index.txt:
+//
+//   category hard
+//   size 30 16
+//   mines 99
+//   board
+//   <height rows of width characters: '.' closed, 'F' flagged, '0'-'8' open>
+//   result <cell> <certain 0/1> <exact 0/1> <mine probability>
+//   safe <count> <cells...>
+//   mines <count> <cells...>
+//   probabilities <count>
+//   <cell> <mine probability>   (one line per frontier cell)
+//
+// Cells are indices into the board (y * width + x). Everything after "board" is what the solver answered when the
+// position was recorded, the runner fails if any of it changes.
+
+#define CORPUS_TOLERANCE 1e-6
+
+typedef struct Position {
+  char category[32];
+  int width;
+  int height;
+  int mines;
+  uint8_t *board;
+} Position;
+
+typedef struct Answer {
+  SolverResult result;
+  int num_safe;
+  int32_t *safe_cells;
+  int num_mines;
+  int32_t *mine_cells;
+  int num_probabilities;
+  int32_t *probability_cells;
+  double *probabilities;
+} Answer;
+
+static int compareInts(const void *a, const void *b) {
+  const int32_t x = *(const int32_t *)a;
+  const int32_t y = *(const int32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void freeAnswer(Answer *answer) {
+  free(answer->safe_cells);
+  free(answer->mine_cells);
+  free(answer->probability_cells);
+  free(answer->probabilities);
+  *answer = (Answer){0};
+}
+
+// Solver output in a canonical form: sorted cell lists and a probability per frontier cell
+static void collectAnswer(const Solver *solver, Answer *answer) {
+  const int cells = solver->width * solver->height;
+  answer->result = solver->result;
+  answer->num_safe = solver->num_safe;
+  answer->safe_cells = malloc(sizeof(int32_t) * (solver->num_safe + 1));
+  memcpy(answer->safe_cells, solver->safe_cells, sizeof(int32_t) * solver->num_safe);
+  qsort(answer->safe_cells, answer->num_safe, sizeof(int32_t), compareInts);
+  answer->num_mines = solver->num_mines_found;
+  answer->mine_cells = malloc(sizeof(int32_t) * (solver->num_mines_found + 1));
+  memcpy(answer->mine_cells, solver->mine_cells, sizeof(int32_t) * solver->num_mines_found);
+  qsort(answer->mine_cells, answer->num_mines, sizeof(int32_t), compareInts);
+  answer->num_probabilities = 0;
+  answer->probability_cells = malloc(sizeof(int32_t) * cells);
+  answer->probabilities = malloc(sizeof(double) * cells);
+  for (int cell = 0; cell < cells; ++cell) {
+    const double probability = solverCellProbability(solver, cell);
+    if (probability >= 0.0) {
+      answer->probability_cells[answer->num_probabilities] = cell;
+      answer->probabilities[answer->num_probabilities++] = probability;
+    }
+  }
+}
+
+static bool readCells(FILE *file, const char *keyword, int *count, int32_t **cells) {
+  char word[32];
+  if (fscanf(file, "%31s %d", word, count) != 2 || strcmp(word, keyword) != 0 || *count < 0) {
+    return false;
+  }
+  *cells = malloc(sizeof(int32_t) * (*count + 1));
+  for (int i = 0; i < *count; ++i) {
+    if (fscanf(file, "%d", &(*cells)[i]) != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool loadPosition(const char *path, Position *position, Answer *expected) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    return false;
+  }
+  bool ok = fscanf(file, " category %31s size %d %d mines %d board", position->category, &position->width, &position->height,
+                   &position->mines) == 4 &&
+            position->width > 0 && position->height > 0;
+  if (ok) {
+    position->board = malloc(sizeof(uint8_t) * position->width * position->height);
+    char *row = malloc(position->width + 2);
+    char format[32];
+    snprintf(format, sizeof(format), "%%%ds", position->width + 1);
+    for (int y = 0; ok && y < position->height; ++y) {
+      ok = fscanf(file, format, row) == 1 && (int)strlen(row) == position->width;
+      for (int x = 0; ok && x < position->width; ++x) {
+        uint8_t *cell = &position->board[y * position->width + x];
+        if (row[x] == '.') {
+          *cell = setDisplayState(0, cell_display_state_closed);
+        } else if (row[x] == 'F') {
+          *cell = setDisplayState(0, cell_display_state_flagged);
+        } else if (row[x] >= '0' && row[x] <= '8') {
+          *cell = setDisplayState(row[x] - '0', cell_display_state_open);
+        } else {
+          ok = false;
+        }
+      }
+    }
+    free(row);
+  }
+  int certain, exact;
+  float probability;
+  ok = ok &&
+       fscanf(file, " result %d %d %d %f", &expected->result.cell, &certain, &exact, &probability) == 4 &&
+       readCells(file, "safe", &expected->num_safe, &expected->safe_cells) &&
+       readCells(file, "mines", &expected->num_mines, &expected->mine_cells) &&
+       fscanf(file, " probabilities %d", &expected->num_probabilities) == 1 && expected->num_probabilities >= 0;
+  if (ok) {
+    expected->result.certain = certain;
+    expected->result.exact = exact;
+    expected->result.mine_probability = probability;
+    expected->probability_cells = malloc(sizeof(int32_t) * (expected->num_probabilities + 1));
+    expected->probabilities = malloc(sizeof(double) * (expected->num_probabilities + 1));
+    for (int i = 0; ok && i < expected->num_probabilities; ++i) {
+      ok = fscanf(file, "%d %lf", &expected->probability_cells[i], &expected->probabilities[i]) == 2;
+    }
+  }
+  fclose(file);
+  return ok;
+}
+
+static bool savePosition(const char *path, const Position *position, const Answer *answer) {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    return false;
+  }
+  fprintf(file, "category %s\nsize %d %d\nmines %d\nboard\n", position->category, position->width, position->height, position->mines);
+  for (int y = 0; y < position->height; ++y) {
+    for (int x = 0; x < position->width; ++x) {
+      const uint8_t cell = position->board[y * position->width + x];
+      const uint8_t state = getDisplayState(cell);
+      fputc(state == cell_display_state_open ? '0' + getNumber(cell) : (state == cell_display_state_flagged ? 'F' : '.'), file);
+    }
+    fputc('\n', file);
+  }
+  fprintf(file, "result %d %d %d %.9f\n", answer->result.cell, answer->result.certain, answer->result.exact,
+          answer->result.mine_probability);
+  fprintf(file, "safe %d", answer->num_safe);
+  for (int i = 0; i < answer->num_safe; ++i) {
+    fprintf(file, " %d", answer->safe_cells[i]);
+  }
+  fprintf(file, "\nmines %d", answer->num_mines);
+  for (int i = 0; i < answer->num_mines; ++i) {
+    fprintf(file, " %d", answer->mine_cells[i]);
+  }
+  fprintf(file, "\nprobabilities %d\n", answer->num_probabilities);
+  for (int i = 0; i < answer->num_probabilities; ++i) {
+    fprintf(file, "%d %.9f\n", answer->probability_cells[i], answer->probabilities[i]);
+  }
+  return fclose(file) == 0;
+}
+
+// Describes the first difference in message, empty if the answers match
+static void compareAnswers(const Answer *expected, const Answer *actual, char *message, size_t size) {
+  message[0] = '\0';
+  if (expected->result.cell != actual->result.cell || expected->result.certain != actual->result.certain ||
+      expected->result.exact != actual->result.exact ||
+      fabs(expected->result.mine_probability - actual->result.mine_probability) > CORPUS_TOLERANCE) {
+    snprintf(message, size, "result %d %d %d %.6f, expected %d %d %d %.6f", actual->result.cell, actual->result.certain,
+             actual->result.exact, actual->result.mine_probability, expected->result.cell, expected->result.certain,
+             expected->result.exact, expected->result.mine_probability);
+  } else if (expected->num_safe != actual->num_safe ||
+             memcmp(expected->safe_cells, actual->safe_cells, sizeof(int32_t) * expected->num_safe) != 0) {
+    snprintf(message, size, "safe set differs (%d cells, expected %d)", actual->num_safe, expected->num_safe);
+  } else if (expected->num_mines != actual->num_mines ||
+             memcmp(expected->mine_cells, actual->mine_cells, sizeof(int32_t) * expected->num_mines) != 0) {
+    snprintf(message, size, "mine set differs (%d cells, expected %d)", actual->num_mines, expected->num_mines);
+  } else if (expected->num_probabilities != actual->num_probabilities) {
+    snprintf(message, size, "%d probabilities, expected %d", actual->num_probabilities, expected->num_probabilities);
+  } else {
+    for (int i = 0; i < expected->num_probabilities; ++i) {
+      if (expected->probability_cells[i] != actual->probability_cells[i] ||
+          fabs(expected->probabilities[i] - actual->probabilities[i]) > CORPUS_TOLERANCE) {
+        snprintf(message, size, "cell %d: probability %.6f, expected %.6f", actual->probability_cells[i], actual->probabilities[i],
+                 expected->probabilities[i]);
+        return;
+      }
+    }
+  }
+}
+
+typedef struct CorpusSpec {
+  const char *category;
+  int count;
+  int width;
+  int height;
+  int mines;
+} CorpusSpec;
+
+// Positions worth keeping for a category, checked after every bot move
+static bool isCorpusPosition(const char *category, const Solver *solver, uint64_t moves) {
+  if (strcmp(category, "easy") == 0) {
+    return moves >= 2 && solver->num_safe > 0 && !solver->enumerated;
+  }
+  if (strcmp(category, "hard") == 0) {
+    return solver->num_safe == 0 && solver->enumerated && solver->result.exact && solver->num_vars >= 12;
+  }
+  if (strcmp(category, "endgame") == 0) {
+    return solver->enumerated && solver->unknown_cells <= 24;
+  }
+  // Huge frontier: mostly scan and rules work, guessing positions on big boards rarely have a large frontier
+  return solver->num_vars >= 300;
+}
+
+// Survived guesses spread over the board, every 4th cell in both directions opened without flooding. Each number opened
+// this way is a component of its own, far more than exact weighting takes.
+static void openScattered(uint8_t *board) {
+  generateMines(board, 0, 0);
+  for (int y = 1; y < board_height; y += 4) {
+    for (int x = 1; x < board_width; x += 4) {
+      const uint8_t number = getNumber(BOARD(x, y));
+      if (number > 0 && number < 9) {
+        BOARD(x, y) = setDisplayState(number, cell_display_state_open);
+      }
+    }
+  }
+}
+
+static bool recordPosition(const char *directory, FILE *index, const char *category, const uint8_t *board, int number,
+                           const Solver *solver) {
+  Position position = {.width = board_width, .height = board_height, .mines = num_mines, .board = (uint8_t *)board};
+  snprintf(position.category, sizeof(position.category), "%s", category);
+  Answer answer = {0};
+  collectAnswer(solver, &answer);
+  char name[64];
+  char path[1024];
+  snprintf(name, sizeof(name), "%s-%02d.txt", category, number);
+  snprintf(path, sizeof(path), "%s/%s", directory, name);
+  const bool saved = savePosition(path, &position, &answer);
+  freeAnswer(&answer);
+  if (!saved) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return false;
+  }
+  fprintf(index, "%s\n", name);
+  printf("recorded %s\n", path);
+  return true;
+}
+
+// Plays bot games from a fixed seed and saves positions of each category with the current solver's answers
+static int recordCorpus(const char *directory) {
+  const CorpusSpec specs[] = {
+      {"easy", 4, 16, 16, 40},
+      {"hard", 4, 30, 16, 99},
+      {"endgame", 4, 30, 16, 99},
+      {"huge-frontier", 3, 100, 100, 2000},
+      {"many-components", 1, 100, 100, 2000},
+  };
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/index.txt", directory);
+  FILE *index = fopen(path, "w");
+  if (!index) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return 1;
+  }
+
+  seedRandom(20240501);
+  Solver solver = {0};
+  Bot bot = {0};
+  for (size_t s = 0; s < sizeof(specs) / sizeof(specs[0]); ++s) {
+    const CorpusSpec *spec = &specs[s];
+    board_width = spec->width;
+    board_height = spec->height;
+    num_mines = spec->mines;
+    uint8_t *board = malloc(sizeof(uint8_t) * board_width * board_height);
+    int found = 0;
+    while (found < spec->count) {
+      resetGame(board);
+      if (strcmp(spec->category, "many-components") == 0) {
+        openScattered(board);
+        solverStart(&solver, board, board_width, board_height, num_mines);
+        solverStep(&solver, 0.0);
+        if (!recordPosition(directory, index, spec->category, board, ++found, &solver)) {
+          return 1;
+        }
+        continue;
+      }
+      botReset(&bot);
+      // At most one position per game so the corpus covers different boards
+      bool taken = false;
+      while (!taken && botStep(&bot, board, 0.0) == BOT_MOVED && game_running) {
+        solverStart(&solver, board, board_width, board_height, num_mines);
+        solverStep(&solver, 0.0);
+        if (!isCorpusPosition(spec->category, &solver, bot.moves)) {
+          continue;
+        }
+        if (!recordPosition(directory, index, spec->category, board, ++found, &solver)) {
+          return 1;
+        }
+        taken = true;
+      }
+    }
+    free(board);
+  }
+  botFree(&bot);
+  solverFree(&solver);
+  fclose(index);
+  return 0;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// minesweeper-solver-bench [corpus directory] [--record]
+// Solves every position listed in the corpus index, reports the median solve time and fails if any answer differs from
+// the recorded one. --record replaces the corpus with new positions and the current solver's answers.
+int main(int argc, char **argv) {
+  const char *directory = "bench/corpus";
+  bool record = false;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--record") == 0) {
+      record = true;
+    } else if (argv[i][0] != '-') {
+      directory = argv[i];
+    } else {
+      fprintf(stderr, "usage: minesweeper-solver-bench [corpus directory] [--record]\n");
+      return 1;
+    }
+  }
+  if (record) {
+    return recordCorpus(directory);
+  }
+
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/index.txt", directory);
+  FILE *index = fopen(path, "r");
+  if (!index) {
+    fprintf(stderr, "cannot read %s\n", path);
+    return 1;
+  }
+
+  const int max_repetitions = 200;
+  const double measure_seconds = 0.2;
+  double samples[200];
+  Solver solver = {0};
+  int positions = 0;
+  int failures = 0;
+  char name[256];
+  printf("%-22s %-14s %9s %7s %8s %12s %12s  %s\n", "position", "category", "board", "unknown", "frontier", "median ms", "max ms",
+         "answer");
+  while (fscanf(index, "%255s", name) == 1) {
+    snprintf(path, sizeof(path), "%s/%s", directory, name);
+    Position position = {0};
+    Answer expected = {0};
+    ++positions;
+    if (!loadPosition(path, &position, &expected)) {
+      printf("%-22s cannot load\n", name);
+      ++failures;
+      free(position.board);
+      freeAnswer(&expected);
+      continue;
+    }
+
+    int repetitions = 0;
+    const uint64_t measure_end = getNanoseconds() + (uint64_t)(measure_seconds * 1e9);
+    while (repetitions < max_repetitions && (repetitions < 3 || getNanoseconds() < measure_end)) {
+      const uint64_t start = getNanoseconds();
+      solverStart(&solver, position.board, position.width, position.height, position.mines);
+      solverStep(&solver, 0.0);
+      samples[repetitions++] = (getNanoseconds() - start) * 1e-6;
+    }
+    qsort(samples, repetitions, sizeof(double), compareDoubles);
+
+    Answer actual = {0};
+    collectAnswer(&solver, &actual);
+    char message[256];
+    compareAnswers(&expected, &actual, message, sizeof(message));
+    failures += message[0] != '\0';
+
+    char size[32];
+    snprintf(size, sizeof(size), "%dx%d", position.width, position.height);
+    printf("%-22s %-14s %9s %7d %8d %12.3f %12.3f  %s\n", name, position.category, size, solver.unknown_cells, solver.num_vars,
+           samples[repetitions / 2], samples[repetitions - 1], message[0] ? message : "ok");
+    freeAnswer(&actual);
+    freeAnswer(&expected);
+    free(position.board);
+  }
+  fclose(index);
+  solverFree(&solver);
+
+  printf("%d positions, %d changed\n", positions, failures);
+  return positions == 0 || failures > 0;
+}
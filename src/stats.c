@@ -0,0 +1,308 @@
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codec.h"
+#include "iowriter.h"
+#include "memtrack.h"
+#include "platform.h"
+
+static const char log_magic[3] = {'M', 'S', 'L'};
+static const char index_magic[3] = {'M', 'S', 'X'};
+
+#define LOG_HEADER_SIZE 4
+#define RECORD_SIZE 40
+
+static void putLittle(uint8_t *out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    out[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+static uint64_t getLittle(const uint8_t *in, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; ++i) {
+    value |= (uint64_t)in[i] << (8 * i);
+  }
+  return value;
+}
+
+static void encodeRecord(const StatsRecord *record, uint8_t *out) {
+  putLittle(out, (uint64_t)record->date, 8);
+  putLittle(out + 8, record->seed, 8);
+  putLittle(out + 16, record->time_ms, 4);
+  putLittle(out + 20, record->bbbv, 4);
+  putLittle(out + 24, (uint32_t)record->width, 4);
+  putLittle(out + 28, (uint32_t)record->height, 4);
+  putLittle(out + 32, (uint32_t)record->mines, 4);
+  putLittle(out + 36, record->flags, 4);
+}
+
+static void decodeRecord(const uint8_t *in, StatsRecord *record) {
+  record->date = (int64_t)getLittle(in, 8);
+  record->seed = getLittle(in + 8, 8);
+  record->time_ms = (uint32_t)getLittle(in + 16, 4);
+  record->bbbv = (uint32_t)getLittle(in + 20, 4);
+  record->width = (int32_t)getLittle(in + 24, 4);
+  record->height = (int32_t)getLittle(in + 28, 4);
+  record->mines = (int32_t)getLittle(in + 32, 4);
+  record->flags = (uint32_t)getLittle(in + 36, 4);
+}
+
+static int bucketOf(uint32_t time_ms) {
+  if (time_ms < 16) {
+    return (int)time_ms;
+  }
+  int exponent = 31;
+  while (!(time_ms >> exponent)) {
+    --exponent;
+  }
+  return 16 + (exponent - 4) * 16 + (int)((time_ms >> (exponent - 4)) & 15);
+}
+
+static StatsDifficulty *findDifficulty(const Stats *stats, int width, int height, int mines, bool no_guess) {
+  for (int i = 0; i < stats->num_difficulties; ++i) {
+    StatsDifficulty *difficulty = &stats->difficulties[i];
+    if (difficulty->width == width && difficulty->height == height && difficulty->mines == mines && difficulty->no_guess == no_guess) {
+      return difficulty;
+    }
+  }
+  return NULL;
+}
+
+static StatsDifficulty *addDifficulty(Stats *stats) {
+  if (stats->num_difficulties == stats->capacity) {
+    stats->capacity = stats->capacity ? stats->capacity * 2 : 8;
+    stats->difficulties = memRealloc(MEM_STATS, stats->difficulties, sizeof(StatsDifficulty) * stats->capacity);
+  }
+  StatsDifficulty *difficulty = &stats->difficulties[stats->num_difficulties++];
+  *difficulty = (StatsDifficulty){0};
+  return difficulty;
+}
+
+// Folds the next record of the log into the aggregates
+static void addRecord(Stats *stats, const StatsRecord *record) {
+  const bool no_guess = record->flags & STATS_NO_GUESS;
+  StatsDifficulty *difficulty = findDifficulty(stats, record->width, record->height, record->mines, no_guess);
+  if (!difficulty) {
+    difficulty = addDifficulty(stats);
+    difficulty->width = record->width;
+    difficulty->height = record->height;
+    difficulty->mines = record->mines;
+    difficulty->no_guess = no_guess;
+  }
+  ++difficulty->games;
+  difficulty->wins += (record->flags & STATS_WON) != 0;
+  if (STATS_RANKED(record->flags)) {
+    ++difficulty->ranked_wins;
+    difficulty->ranked_ms += record->time_ms;
+    ++difficulty->buckets[bucketOf(record->time_ms)];
+    // Later records lose ties, they come after the ones already in the list
+    int slot = difficulty->num_best;
+    while (slot > 0 && difficulty->best[slot - 1].time_ms > record->time_ms) {
+      --slot;
+    }
+    if (slot < STATS_TOP_TIMES) {
+      const int moved = (difficulty->num_best < STATS_TOP_TIMES ? difficulty->num_best : STATS_TOP_TIMES - 1) - slot;
+      memmove(&difficulty->best[slot + 1], &difficulty->best[slot], sizeof(StatsBest) * moved);
+      difficulty->best[slot] = (StatsBest){record->time_ms, record->bbbv, record->date, stats->records};
+      difficulty->num_best += difficulty->num_best < STATS_TOP_TIMES;
+    }
+  }
+  ++stats->records;
+}
+
+static void resetAggregates(Stats *stats) {
+  stats->records = 0;
+  stats->num_difficulties = 0;
+}
+
+static bool loadIndex(Stats *stats) {
+  uint8_t *data = NULL;
+  size_t capacity = 0;
+  FileView view;
+  if (!openFileView(stats->index_path, &view, &data, &capacity)) {
+    free(data);
+    return false;
+  }
+  ByteReader reader = {view.data, view.size, sizeof(index_magic) + 1, false};
+  bool loaded = view.size >= sizeof(index_magic) + 1 && memcmp(view.data, index_magic, sizeof(index_magic)) == 0 &&
+                view.data[sizeof(index_magic)] == STATS_VERSION;
+  stats->records = (uint32_t)getVarint(&reader);
+  const uint64_t num_difficulties = getVarint(&reader);
+  loaded = loaded && !reader.failed && num_difficulties <= view.size;
+  for (uint64_t i = 0; i < num_difficulties && loaded; ++i) {
+    StatsDifficulty *difficulty = addDifficulty(stats);
+    difficulty->width = (int32_t)getVarint(&reader);
+    difficulty->height = (int32_t)getVarint(&reader);
+    difficulty->mines = (int32_t)getVarint(&reader);
+    difficulty->no_guess = getVarint(&reader) != 0;
+    difficulty->games = (uint32_t)getVarint(&reader);
+    difficulty->wins = (uint32_t)getVarint(&reader);
+    difficulty->ranked_wins = (uint32_t)getVarint(&reader);
+    difficulty->ranked_ms = getVarint(&reader);
+    const uint64_t num_best = getVarint(&reader);
+    loaded = num_best <= STATS_TOP_TIMES;
+    difficulty->num_best = loaded ? (int)num_best : 0;
+    for (int j = 0; j < difficulty->num_best; ++j) {
+      StatsBest *best = &difficulty->best[j];
+      best->time_ms = (uint32_t)getVarint(&reader);
+      best->bbbv = (uint32_t)getVarint(&reader);
+      best->date = unzigzag(getVarint(&reader));
+      best->record = (uint32_t)getVarint(&reader);
+    }
+    // Buckets as gaps to the next nonzero one and its count
+    int bucket = -1;
+    for (uint64_t gap = getVarint(&reader); gap > 0 && loaded; gap = getVarint(&reader)) {
+      bucket += (int)(gap < STATS_BUCKETS ? gap : STATS_BUCKETS);
+      loaded = bucket < STATS_BUCKETS;
+      if (loaded) {
+        difficulty->buckets[bucket] = (uint32_t)getVarint(&reader);
+      }
+    }
+    loaded = loaded && !reader.failed;
+  }
+  closeFileView(&view);
+  free(data);
+  if (!loaded) {
+    resetAggregates(stats);
+  }
+  return loaded;
+}
+
+static bool saveIndex(const Stats *stats) {
+  ByteBuffer buffer = {0};
+  bufferReserve(&buffer, MEM_STATS, sizeof(index_magic) + 1 + 2 * 10);
+  memcpy(buffer.data, index_magic, sizeof(index_magic));
+  buffer.size = sizeof(index_magic);
+  buffer.data[buffer.size++] = STATS_VERSION;
+  putVarint(&buffer, stats->records);
+  putVarint(&buffer, stats->num_difficulties);
+  for (int i = 0; i < stats->num_difficulties; ++i) {
+    const StatsDifficulty *difficulty = &stats->difficulties[i];
+    bufferReserve(&buffer, MEM_STATS, 10 * 10 + STATS_TOP_TIMES * 4 * 10 + STATS_BUCKETS * 2 * 10);
+    putVarint(&buffer, (uint32_t)difficulty->width);
+    putVarint(&buffer, (uint32_t)difficulty->height);
+    putVarint(&buffer, (uint32_t)difficulty->mines);
+    putVarint(&buffer, difficulty->no_guess);
+    putVarint(&buffer, difficulty->games);
+    putVarint(&buffer, difficulty->wins);
+    putVarint(&buffer, difficulty->ranked_wins);
+    putVarint(&buffer, difficulty->ranked_ms);
+    putVarint(&buffer, difficulty->num_best);
+    for (int j = 0; j < difficulty->num_best; ++j) {
+      const StatsBest *best = &difficulty->best[j];
+      putVarint(&buffer, best->time_ms);
+      putVarint(&buffer, best->bbbv);
+      putVarint(&buffer, zigzag(best->date));
+      putVarint(&buffer, best->record);
+    }
+    int previous = -1;
+    for (int bucket = 0; bucket < STATS_BUCKETS; ++bucket) {
+      if (difficulty->buckets[bucket]) {
+        putVarint(&buffer, bucket - previous);
+        putVarint(&buffer, difficulty->buckets[bucket]);
+        previous = bucket;
+      }
+    }
+    putVarint(&buffer, 0);
+  }
+
+  // Rebuilt from the log if it is lost, no need to wait for the disk
+  const bool saved = ioWrite(stats->index_path, IO_REPLACE, IO_SYNC_NONE, 0, buffer.data, buffer.size);
+  memFree(buffer.data);
+  return saved;
+}
+
+// Whole records in the log, a record cut short by a crash is overwritten by the next append. So is a header cut short, the
+// log counts as empty then and the next append writes the header again. -1 if it isn't a log.
+static int64_t countRecords(FILE *file) {
+  const uint8_t expected[LOG_HEADER_SIZE] = {log_magic[0], log_magic[1], log_magic[2], STATS_VERSION};
+  uint8_t header[LOG_HEADER_SIZE];
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (size <= 0) {
+    return 0;
+  }
+  const size_t length = size < LOG_HEADER_SIZE ? (size_t)size : LOG_HEADER_SIZE;
+  if (fread(header, 1, length, file) != length || memcmp(header, expected, length) != 0) {
+    return -1;
+  }
+  return size < LOG_HEADER_SIZE ? 0 : (size - LOG_HEADER_SIZE) / RECORD_SIZE;
+}
+
+bool statsOpen(Stats *stats, const char *log_path, const char *index_path) {
+  *stats = (Stats){0};
+  stats->log_path = log_path;
+  stats->index_path = index_path;
+  FILE *file = fopen(log_path, "rb");
+  const int64_t records = file ? countRecords(file) : 0;
+  if (records < 0) {
+    fprintf(stderr, "stats: %s is not a statistics log\n", log_path);
+    fclose(file);
+    return false;
+  }
+  // An index ahead of the log belongs to some other log
+  if (!loadIndex(stats) || stats->records > records) {
+    resetAggregates(stats);
+  }
+  if (stats->records < records) {
+    fseek(file, LOG_HEADER_SIZE + (long)stats->records * RECORD_SIZE, SEEK_SET);
+    uint8_t data[RECORD_SIZE];
+    StatsRecord record;
+    while (stats->records < records && fread(data, 1, sizeof(data), file) == sizeof(data)) {
+      decodeRecord(data, &record);
+      addRecord(stats, &record);
+    }
+    saveIndex(stats);
+  }
+  if (file) {
+    fclose(file);
+  }
+  return true;
+}
+
+bool statsAppend(Stats *stats, const StatsRecord *record) {
+  // The first record comes with the header
+  uint8_t data[LOG_HEADER_SIZE + RECORD_SIZE] = {log_magic[0], log_magic[1], log_magic[2], STATS_VERSION};
+  const int64_t offset = stats->records == 0 ? 0 : LOG_HEADER_SIZE + (int64_t)stats->records * RECORD_SIZE;
+  uint8_t *start = stats->records == 0 ? data : data + LOG_HEADER_SIZE;
+  encodeRecord(record, data + LOG_HEADER_SIZE);
+  if (!ioWrite(stats->log_path, IO_AT, IO_SYNC_BATCH, offset, start, data + sizeof(data) - start)) {
+    return false;
+  }
+  addRecord(stats, record);
+  return saveIndex(stats);
+}
+
+const StatsDifficulty *statsFind(const Stats *stats, int width, int height, int mines, bool no_guess) {
+  return findDifficulty(stats, width, height, mines, no_guess);
+}
+
+uint32_t statsPercentile(const StatsDifficulty *difficulty, double fraction) {
+  if (difficulty->ranked_wins == 0) {
+    return 0;
+  }
+  const double wanted = fraction * difficulty->ranked_wins;
+  const uint64_t target = wanted > 1.0 ? (uint64_t)wanted + (wanted > (uint64_t)wanted) : 1;
+  uint64_t seen = 0;
+  int bucket = 0;
+  while (bucket < STATS_BUCKETS - 1 && (seen += difficulty->buckets[bucket]) < target) {
+    ++bucket;
+  }
+  if (bucket < 16) {
+    return (uint32_t)bucket;
+  }
+  // Middle of the bucket, but no faster than the best time
+  const int shift = (bucket - 16) / 16;
+  const uint32_t middle = ((uint32_t)(16 + (bucket - 16) % 16) << shift) + ((1u << shift) >> 1);
+  return middle > difficulty->best[0].time_ms ? middle : difficulty->best[0].time_ms;
+}
+
+void statsClose(Stats *stats) {
+  memFree(stats->difficulties);
+  *stats = (Stats){0};
+}
@@ -0,0 +1,83 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Finished games, appended to a log of fixed size records, with an index of per difficulty aggregates (counts, best times,
+// a histogram of winning times) that is updated on every append. Opening the stats only reads the index and folds in the
+// records it hasn't seen yet, normally none, so it costs the same however many games were logged. The index is rebuilt
+// from the log when it is missing or doesn't match.
+//
+//   log:   "MSL", version byte, then 40 byte little endian records: date, seed, time ms, 3BV, width, height, mines, flags
+//   index: "MSX", version byte, varint records covered, difficulties, then per difficulty its fields and nonzero buckets
+
+#define STATS_VERSION 1
+// Best times kept per difficulty
+#define STATS_TOP_TIMES 10
+// Winning times below 16 ms get a bucket each, above that every power of two is split into 16, so percentiles are within
+// a few percent of the real time
+#define STATS_BUCKETS 464
+
+typedef enum StatsFlags {
+  STATS_WON = 1,
+  STATS_NO_GUESS = 2,
+  STATS_ASSISTED = 4, // the hint or the bot was used
+  STATS_RESUMED = 8,  // continued from a saved game
+  STATS_SHARED = 16   // started from a share code, the layout may have been seen before
+} StatsFlags;
+
+// Only unassisted wins of fresh games count towards best times and percentiles
+#define STATS_RANKED(flags) (((flags) & (STATS_WON | STATS_ASSISTED | STATS_RESUMED | STATS_SHARED)) == STATS_WON)
+
+typedef struct StatsRecord {
+  int64_t date; // seconds since the epoch
+  uint64_t seed; // 0 when the layout can't be reproduced
+  uint32_t time_ms;
+  uint32_t bbbv; // 0 for losses
+  int32_t width;
+  int32_t height;
+  int32_t mines;
+  uint32_t flags;
+} StatsRecord;
+
+typedef struct StatsBest {
+  uint32_t time_ms;
+  uint32_t bbbv;
+  int64_t date;
+  uint32_t record; // position in the log
+} StatsBest;
+
+typedef struct StatsDifficulty {
+  int32_t width;
+  int32_t height;
+  int32_t mines;
+  bool no_guess;
+  uint32_t games;
+  uint32_t wins;
+  uint32_t ranked_wins;
+  uint64_t ranked_ms; // sum of the ranked winning times
+  int num_best;
+  StatsBest best[STATS_TOP_TIMES]; // fastest first
+  uint32_t buckets[STATS_BUCKETS];
+} StatsDifficulty;
+
+typedef struct Stats {
+  const char *log_path;
+  const char *index_path;
+  uint32_t records;
+  StatsDifficulty *difficulties;
+  int num_difficulties;
+  int capacity;
+} Stats;
+
+// The paths are kept, false if the log exists but isn't one
+bool statsOpen(Stats *stats, const char *log_path, const char *index_path);
+bool statsAppend(Stats *stats, const StatsRecord *record);
+// NULL until a game of that difficulty was logged
+const StatsDifficulty *statsFind(const Stats *stats, int width, int height, int mines, bool no_guess);
+// Ranked winning time at or below which the fraction of them lies, 0 without any
+uint32_t statsPercentile(const StatsDifficulty *difficulty, double fraction);
+void statsClose(Stats *stats);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef THREADLOCAL_H
+#define THREADLOCAL_H
+
+// thread_local comes from C11 <threads.h> until C23 makes it a keyword. MSVC doesn't define it there, it has its own
+// storage class for thread local variables.
+#if defined(_MSC_VER)
+#ifndef thread_local
+#define thread_local __declspec(thread)
+#endif
+#elif !defined(__STDC_VERSION__) || __STDC_VERSION__ < 202311L
+#include <threads.h>
+#endif
+
+#endif
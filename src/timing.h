@@ -0,0 +1,20 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Monotonic clock that works without a window (raylib's GetTime() needs InitWindow())
+static inline uint64_t getNanoseconds(void) {
+  struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+  timespec_get(&ts, TIME_UTC);
+#endif
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline double getSeconds(void) { return (double)getNanoseconds() * 1e-9; }
+
+#endif
@@ -0,0 +1,129 @@
+#include "trace.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "threadlocal.h"
+
+// Events are stored in chunks so short lived threads (no-guess workers) stay cheap. A thread stops recording once it has
+// TRACE_MAX_CHUNKS chunks and counts what it drops instead.
+#define TRACE_CHUNK_EVENTS 4096
+#define TRACE_MAX_CHUNKS 256
+
+typedef struct TraceEvent {
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+} TraceEvent;
+
+typedef struct TraceChunk {
+  TraceEvent events[TRACE_CHUNK_EVENTS];
+  // Published with release stores by the owning thread so traceDump can read while it records
+  atomic_int count;
+  _Atomic(struct TraceChunk *) next;
+} TraceChunk;
+
+typedef struct TraceBuffer {
+  struct TraceBuffer *next;
+  int tid;
+  _Atomic(const char *) name;
+  TraceChunk *first;
+  TraceChunk *current; // owner only
+  int chunks;          // owner only
+  atomic_uint_fast64_t dropped;
+} TraceBuffer;
+
+// Buffers are never freed: a thread's spans stay dumpable after it exits
+static _Atomic(TraceBuffer *) trace_buffers = NULL;
+static atomic_int trace_next_tid = 1;
+static thread_local TraceBuffer *trace_buffer = NULL;
+
+static TraceChunk *newChunk(void) {
+  TraceChunk *chunk = malloc(sizeof(TraceChunk));
+  atomic_init(&chunk->count, 0);
+  atomic_init(&chunk->next, NULL);
+  return chunk;
+}
+
+static TraceBuffer *threadBuffer(void) {
+  if (trace_buffer) {
+    return trace_buffer;
+  }
+  TraceBuffer *buffer = malloc(sizeof(TraceBuffer));
+  buffer->tid = atomic_fetch_add(&trace_next_tid, 1);
+  atomic_init(&buffer->name, NULL);
+  buffer->first = newChunk();
+  buffer->current = buffer->first;
+  buffer->chunks = 1;
+  atomic_init(&buffer->dropped, 0);
+  buffer->next = atomic_load(&trace_buffers);
+  while (!atomic_compare_exchange_weak(&trace_buffers, &buffer->next, buffer))
+    ;
+  trace_buffer = buffer;
+  return buffer;
+}
+
+void traceRecord(const char *name, uint64_t start, uint64_t end) {
+  TraceBuffer *buffer = threadBuffer();
+  TraceChunk *chunk = buffer->current;
+  int count = atomic_load_explicit(&chunk->count, memory_order_relaxed);
+  if (count == TRACE_CHUNK_EVENTS) {
+    if (buffer->chunks == TRACE_MAX_CHUNKS) {
+      atomic_fetch_add_explicit(&buffer->dropped, 1, memory_order_relaxed);
+      return;
+    }
+    TraceChunk *next = newChunk();
+    atomic_store_explicit(&chunk->next, next, memory_order_release);
+    buffer->current = chunk = next;
+    ++buffer->chunks;
+    count = 0;
+  }
+  chunk->events[count] = (TraceEvent){name, start, end};
+  atomic_store_explicit(&chunk->count, count + 1, memory_order_release);
+}
+
+void traceThreadName(const char *name) { atomic_store_explicit(&threadBuffer()->name, name, memory_order_release); }
+
+bool traceDump(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    return false;
+  }
+
+  // Timestamps relative to the earliest span, in microseconds
+  uint64_t epoch = UINT64_MAX;
+  for (TraceBuffer *buffer = atomic_load(&trace_buffers); buffer; buffer = buffer->next) {
+    const TraceChunk *chunk = buffer->first;
+    if (atomic_load_explicit(&chunk->count, memory_order_acquire) > 0 && chunk->events[0].start < epoch) {
+      epoch = chunk->events[0].start;
+    }
+  }
+
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"minesweeper\"}}");
+  for (TraceBuffer *buffer = atomic_load(&trace_buffers); buffer; buffer = buffer->next) {
+    const char *name = atomic_load_explicit(&buffer->name, memory_order_acquire);
+    fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s %d\"}}", buffer->tid,
+            name ? name : "thread", buffer->tid);
+    const uint64_t dropped = atomic_load_explicit(&buffer->dropped, memory_order_relaxed);
+    if (dropped > 0) {
+      fprintf(stderr, "trace: thread %d dropped %llu spans\n", buffer->tid, (unsigned long long)dropped);
+    }
+    for (const TraceChunk *chunk = buffer->first; chunk; chunk = atomic_load_explicit(&chunk->next, memory_order_acquire)) {
+      const int count = atomic_load_explicit(&chunk->count, memory_order_acquire);
+      for (int i = 0; i < count; ++i) {
+        const TraceEvent *event = &chunk->events[i];
+        fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}", event->name, buffer->tid,
+                (event->start - epoch) * 1e-3, (event->end - event->start) * 1e-3);
+      }
+    }
+  }
+  fprintf(file, "\n]}\n");
+  if (fclose(file) != 0) {
+    return false;
+  }
+  fprintf(stderr, "trace: wrote %s\n", path);
+  return true;
+}
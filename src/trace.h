@@ -0,0 +1,40 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Span recording for chrome://tracing and Perfetto, compiled in with -DMINESWEEPER_TRACE=ON. Every thread appends to its
+// own buffer without locks. Spans are opened and closed by name in the same scope:
+//
+//   TRACE_BEGIN(openCell);
+//   ...
+//   TRACE_END(openCell);
+//
+// Without MINESWEEPER_TRACE every macro expands to nothing.
+
+#ifdef MINESWEEPER_TRACE
+
+#include <stdbool.h>
+
+#include "timing.h"
+
+#define TRACE_BEGIN(name) const uint64_t trace_start_##name = getNanoseconds()
+#define TRACE_END(name) traceRecord(#name, trace_start_##name, getNanoseconds())
+#define TRACE_THREAD_NAME(name) traceThreadName(name)
+#define TRACE_DUMP(path) traceDump(path)
+
+void traceRecord(const char *name, uint64_t start, uint64_t end);
+void traceThreadName(const char *name);
+// Writes every span recorded so far by any thread as trace event JSON, false if the file cannot be written
+bool traceDump(const char *path);
+
+#else
+
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#define TRACE_THREAD_NAME(name)
+#define TRACE_DUMP(path)
+
+#endif
+
+#endif
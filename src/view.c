@@ -0,0 +1,19 @@
+#include "view.h"
+
+#include "engine.h"
+
+bool findCollisionCell(Vector2 mouse_pos, Vector2 top_left, int *out_x, int *out_y) {
+  for (int x = 0; x < board_width; ++x) {
+    for (int y = 0; y < board_height; ++y) {
+      Rectangle cell_rect = {top_left.x + x * 20.0f + 2.0f, top_left.y + y * 20.0f + 2.0f, 16.0f, 16.0f};
+      if (CheckCollisionPointRec(mouse_pos, cell_rect)) {
+        *out_x = x;
+        *out_y = y;
+        return true;
+      }
+    }
+  }
+  *out_x = -1;
+  *out_y = -1;
+  return false;
+}
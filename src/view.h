@@ -0,0 +1,11 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+#include <stdbool.h>
+
+#include <raylib.h>
+
+// Cell under mouse_pos for a board drawn from top_left with 20 pixel cells (each with a 2 pixel dead border)
+bool findCollisionCell(Vector2 mouse_pos, Vector2 top_left, int *out_x, int *out_y);
+
+#endif